@@ -75,6 +75,58 @@ static struct timespec last_stat_time;
 
 static off_t record_start_block; /* block ordinal at record_start */
 
+/* With --drop-cache, the archive is dropped from the page cache this
+   many bytes at a time.  */
+enum { DROP_CACHE_CHUNK = 8 * 1024 * 1024 };
+
+/* True if the archive is dropped from the page cache as it is
+   processed.  */
+static bool archive_cache_drop;
+
+/* Offset of the start of the archive data in the archive file.  */
+static off_t archive_cache_base;
+
+/* Sizes of the archive data that have been handed once and twice to
+   sys_drop_cache.  Data written to the archive can be dropped only
+   once written out, so every range is handed over twice: when it has
+   just been processed, and one chunk later.  */
+static off_t archive_cache_advised;
+static off_t archive_cache_dropped;
+
+/* True if the archive is read or written with direct I/O.  */
+static bool archive_direct_io;
+
+/* With --record-size=auto, archives on disk and pipes are read and
+   written in records of up to this many bytes.  */
+enum
+  {
+    AUTO_RECORD_SIZE_FILE = 1024 * 1024,
+    AUTO_RECORD_SIZE_PIPE = 64 * 1024
+  };
+
+/* With --record-size=auto, the throughput of each record size tried
+   when writing is measured over this many writes.  */
+enum { AUTOTUNE_WRITES = 8 };
+
+/* The record size given by the options.  With --record-size=auto,
+   it is still the size of the records on the media: the archive is
+   padded to a multiple of it, and the record size used for I/O is a
+   multiple of it.  */
+static idx_t media_record_size;
+
+/* With --record-size=auto, while the best record size for writing the
+   archive is being looked for: the largest record size to try (0 once
+   the search is over), the number of writes made and the time spent
+   in them at the current record size, and the throughput of the
+   previous record size, in bytes per nanosecond.  */
+static struct autotune
+{
+  idx_t max;
+  int writes;
+  double ns;
+  double rate;
+} autotune;
+
 /* Where we write list messages (not errors, not interactions) to.  */
 FILE *stdlis;
 
@@ -434,6 +486,22 @@ check_compressed_archive (bool *pshort)
   return ct_none;
 }
 
+/* If --read-ahead was given, let a child process read the uncompressed
+   archive open on ARCHIVE ahead of us.  Remote archives are read
+   directly, as the rmt connection cannot be shared.  Return the
+   descriptor to read the archive from.  */
+static int
+start_read_ahead (void)
+{
+  if (read_ahead_option && !_isrmt (archive))
+    {
+      child_pid = sys_child_open_for_read_ahead (read_ahead_option);
+      if (child_pid)
+	read_full_records = true;
+    }
+  return archive;
+}
+
 /* Open an archive named archive_name_array[0]. Detect if it is
    a compressed archive of known type and use corresponding decompression
    program if so */
@@ -457,7 +525,7 @@ open_compressed_archive (void)
             case ct_tar:
               if (shortfile)
 		paxerror (0, _("This does not look like a tar archive"));
-              return archive;
+              return start_read_ahead ();
 
             case ct_none:
               if (shortfile)
@@ -465,7 +533,7 @@ open_compressed_archive (void)
               set_compression_program_by_suffix (archive_name_array[0], NULL,
 						 false);
               if (!use_compress_program_option)
-		return archive;
+		return start_read_ahead ();
               break;
 
             default:
@@ -584,6 +652,26 @@ void
 print_total_stats (void)
 {
   format_total_stats (stderr, default_total_format, '\n', '\n');
+  if (detailed_totals_option)
+    print_detailed_stats (stderr);
+}
+
+/* Return the number of bytes written to the archive so far.  */
+tarlong
+total_bytes_written (void)
+{
+  return prev_written + bytes_written;
+}
+
+/* Return the size of the archive being read, or -1 if it is not known
+   in advance, e.g. because the archive is compressed or is not a
+   regular file.  */
+off_t
+archive_input_size (void)
+{
+  return (access_mode == ACCESS_READ && seekable_archive
+	  && S_ISREG (archive_stat.st_mode) && !_isrmt (archive)
+	  ? archive_stat.st_size : -1);
 }
 
 /* Compute and return the block ordinal at current_block.  */
@@ -655,11 +743,22 @@ available_space_after (union block *pointer)
   return charptr (record_end) - charptr (pointer);
 }
 
+/* Return true if the header at POINTER, the SIZE bytes of data that
+   follow it and the block after them are all in the current record.
+   Data that fits can be used where it lies, as reading the next
+   header will not refill the record.  */
+bool
+fits_in_record (union block *pointer, off_t size)
+{
+  return size <= available_space_after (pointer) - 2 * BLOCKSIZE;
+}
+
 static void
 init_buffer (void)
 {
   if (! record_buffer[record_index])
-    record_buffer[record_index] = xalignalloc (getpagesize (), record_size);
+    record_buffer[record_index] = xalignalloc (getpagesize (),
+					       max (record_size, autotune.max));
 
   record_start = record_buffer[record_index];
   current_block = record_start;
@@ -697,7 +796,7 @@ get_archive_status (enum access_mode wanted_access, bool backed_up_flag)
     }
 
   seekable_archive
-    = (! (multi_volume_option || use_compress_program_option)
+    = (! (multi_volume_option || use_compress_program_option || child_pid)
        && (seek_option < 0
 	   ? (_isrmt (archive)
 	      || ! (S_ISFIFO (archive_stat.st_mode)
@@ -719,6 +818,158 @@ get_archive_status (enum access_mode wanted_access, bool backed_up_flag)
     sys_detect_dev_null_output ();
 
   SET_BINARY_MODE (archive);
+
+  /* Page cache hints apply only to local regular files that are read
+     or written in one pass, not to archives updated in place or split
+     into volumes.  */
+  bool local_file = (S_ISREG (archive_stat.st_mode) && !_isrmt (archive)
+		     && wanted_access != ACCESS_UPDATE && !multi_volume_option);
+  if (local_file && wanted_access == ACCESS_READ)
+    sys_advise_sequential (archive);
+  archive_cache_drop = local_file && drop_cache_option;
+  archive_cache_base = (wanted_access == ACCESS_READ && seekable_archive
+			? start_offset : 0);
+  archive_cache_advised = archive_cache_dropped = 0;
+  archive_direct_io = false;
+  if (local_file && direct_io_option)
+    {
+      if (sys_set_direct_io (archive, true))
+	archive_direct_io = true;
+      else
+	paxwarn (errno, _("%s: Cannot use direct I/O"),
+		 quotearg_colon (*archive_name_cursor));
+    }
+}
+
+/* With --drop-cache, drop the first SIZE bytes of archive data from
+   the page cache, a chunk at a time.  */
+static void
+drop_archive_cache (off_t size)
+{
+  if (archive_cache_drop && DROP_CACHE_CHUNK <= size - archive_cache_advised)
+    {
+      sys_drop_cache (archive, archive_cache_base + archive_cache_dropped,
+		      size - archive_cache_dropped);
+      archive_cache_dropped = archive_cache_advised;
+      archive_cache_advised = size;
+    }
+}
+
+/* If the last read or write of the archive failed with EINVAL because
+   of direct I/O, which needs the record size and the archive offsets
+   to be multiples of the device block size, turn direct I/O off and
+   return true, so that the operation can be retried.  */
+static bool
+direct_io_failed (void)
+{
+  if (! (archive_direct_io && errno == EINVAL))
+    return false;
+  archive_direct_io = false;
+  if (!sys_set_direct_io (archive, false))
+    return false;
+  paxwarn (0, _("%s: Direct I/O failed; using the page cache"),
+	   quotearg_colon (*archive_name_cursor));
+  return true;
+}
+
+/* Return the record size to use for I/O on an archive of type MODE
+   with --record-size=auto, or 0 if the archive must be read and
+   written in records of the size they have on the media.  */
+static idx_t
+auto_record_size (mode_t mode)
+{
+  idx_t size = (S_ISREG (mode) || S_ISBLK (mode) ? AUTO_RECORD_SIZE_FILE
+		: S_ISFIFO (mode) || S_ISSOCK (mode) ? AUTO_RECORD_SIZE_PIPE
+		: 0);
+  size -= size % media_record_size;
+  return media_record_size < size ? size : 0;
+}
+
+/* Run the checkpoint for the record about to be read or written
+   (writing if DO_WRITE), counting it in records of the media size, so
+   that --record-size=auto does not make checkpoints rarer.  */
+static void
+archive_checkpoint (bool do_write)
+{
+  checkpoint_run (do_write, (media_record_size
+			     ? record_size / media_record_size : 1));
+}
+
+/* Set the record size for accessing the archive as WANTED_ACCESS
+   says, before it is opened.  With --record-size=auto, archives on
+   disk and pipes are read in large records.  When they are written,
+   autotune_record_size starts from the media record size and grows it
+   for as long as the throughput improves.  Tapes and other devices,
+   remote archives and archives that are updated in place, split into
+   volumes or verified are accessed in records of the media size.  */
+static void
+choose_record_size (enum access_mode wanted_access)
+{
+  if (!media_record_size)
+    media_record_size = record_size;
+  record_size = media_record_size;
+  blocking_factor = record_size >> LG_BLOCKSIZE;
+  autotune.max = 0;
+
+  if (! (auto_record_size_option && wanted_access != ACCESS_UPDATE
+	 && !multi_volume_option && !tape_length_option && !verify_option))
+    return;
+
+  char const *name = archive_name_array[0];
+  struct stat st;
+  idx_t size;
+  if (use_compress_program_option)
+    size = auto_record_size (S_IFIFO);
+  else if (streq (name, "-"))
+    size = (fstat (wanted_access == ACCESS_READ ? STDIN_FILENO : STDOUT_FILENO,
+		   &st) < 0
+	    ? 0 : auto_record_size (st.st_mode));
+  else if (_remdev (name))
+    size = 0;
+  else if (stat (name, &st) == 0)
+    size = auto_record_size (st.st_mode);
+  else
+    size = (wanted_access == ACCESS_WRITE && errno == ENOENT
+	    ? auto_record_size (S_IFREG) : 0);
+
+  if (!size)
+    return;
+  if (wanted_access == ACCESS_READ)
+    {
+      record_size = size;
+      blocking_factor = record_size >> LG_BLOCKSIZE;
+    }
+  else
+    autotune = (struct autotune) { .max = size };
+}
+
+/* With --record-size=auto, account for a write of the archive that
+   took NS nanoseconds.  After enough writes at the current record
+   size, double it if its throughput beats that of the previous one by
+   a tenth, and otherwise settle on it.  This is called between
+   records, when the buffer is empty.  */
+static void
+autotune_record_size (double ns)
+{
+  autotune.ns += ns;
+  if (++autotune.writes < AUTOTUNE_WRITES)
+    return;
+
+  double rate = AUTOTUNE_WRITES * record_size / max (autotune.ns, 1.0);
+  idx_t size = min (2 * record_size, autotune.max);
+  size -= size % media_record_size;
+  if (rate <= autotune.rate * 1.1 || size <= record_size)
+    {
+      autotune.max = 0;
+      return;
+    }
+
+  autotune.rate = rate;
+  autotune.writes = 0;
+  autotune.ns = 0;
+  record_size = size;
+  blocking_factor = record_size >> LG_BLOCKSIZE;
+  record_end = record_start + blocking_factor;
 }
 
 /* Open an archive file.  The argument specifies whether we are
@@ -736,6 +987,7 @@ _open_archive (enum access_mode wanted_access)
 
   tar_stat_destroy (&current_stat_info);
 
+  choose_record_size (wanted_access);
   record_index = false;
   init_buffer ();
 
@@ -745,7 +997,12 @@ _open_archive (enum access_mode wanted_access)
 
   read_full_records = read_full_records_option;
 
+  /* With --separate-archives, nothing carries over from the previous
+     archive.  */
   records_read = 0;
+  record_start_block = 0;
+  hit_eof = false;
+  archive_compression_type = ct_none;
 
   if (use_compress_program_option)
     {
@@ -791,6 +1048,7 @@ _open_archive (enum access_mode wanted_access)
 			compress_option (type));
             if (shortfile)
 	      paxerror (0, _("This does not look like a tar archive"));
+            start_read_ahead ();
           }
           break;
 
@@ -868,7 +1126,7 @@ _flush_write (void)
 {
   idx_t status;
 
-  checkpoint_run (true);
+  archive_checkpoint (true);
   if (tape_length_option && tape_length_option <= bytes_written)
     {
       errno = ENOSPC;
@@ -877,7 +1135,11 @@ _flush_write (void)
   else if (dev_null_output)
     status = record_size;
   else
-    status = sys_write_archive_buffer ();
+    {
+      status = sys_write_archive_buffer ();
+      if (status == 0 && direct_io_failed ())
+	status = sys_write_archive_buffer ();
+    }
 
   if (status && multi_volume_option && !inhibit_map)
     {
@@ -978,7 +1240,8 @@ short_read (idx_t status)
 	{
 	  ptrdiff_t nread;
 	  while ((nread = rmtread (archive, more, left)) < 0)
-	    archive_read_error ();
+	    if (! direct_io_failed ())
+	      archive_read_error ();
 	  status = nread;
 	}
 
@@ -1009,6 +1272,7 @@ void
 flush_archive (void)
 {
   idx_t buffer_level;
+  struct timespec start = stats_start ();
 
   if (access_mode == ACCESS_READ && time_to_start_writing)
     {
@@ -1037,12 +1301,24 @@ flush_archive (void)
       break;
 
     case ACCESS_WRITE:
-      flush_write_ptr (buffer_level);
+      if (autotune.max)
+	{
+	  struct timespec t = stats_now ();
+	  flush_write_ptr (buffer_level);
+	  struct timespec now = stats_now ();
+	  autotune_record_size (1e9 * (now.tv_sec - t.tv_sec)
+				+ (now.tv_nsec - t.tv_nsec));
+	}
+      else
+	flush_write_ptr (buffer_level);
       break;
 
     case ACCESS_UPDATE:
       abort ();
     }
+
+  drop_archive_cache (record_start_block * BLOCKSIZE);
+  stats_stop (STATS_FLUSH_ARCHIVE, start);
 }
 
 /* Backspace the archive descriptor by one record worth.  If it's a
@@ -1126,6 +1402,18 @@ close_archive (void)
 {
   if (time_to_start_writing || access_mode == ACCESS_WRITE)
     {
+      /* With --record-size=auto, pad the archive only to a multiple
+	 of the media record size.  */
+      if (access_mode == ACCESS_WRITE && media_record_size < record_size)
+	{
+	  idx_t level = charptr (current_block) - charptr (record_start);
+	  record_size = max (media_record_size,
+			     (level + media_record_size - 1)
+			     / media_record_size * media_record_size);
+	  blocking_factor = record_size >> LG_BLOCKSIZE;
+	  record_end = record_start + blocking_factor;
+	}
+
       do
 	flush_archive ();
       while (current_block > record_start);
@@ -1135,14 +1423,19 @@ close_archive (void)
   if (verify_option)
     verify_volume ();
 
+  if (archive_cache_drop)
+    sys_drop_cache (archive, archive_cache_base + archive_cache_dropped, 0);
+
   if (rmtclose (archive) < 0)
     close_error (*archive_name_cursor);
 
   sys_wait_for_child (child_pid, hit_eof);
+  child_pid = 0;
 
   tar_stat_destroy (&current_stat_info);
   alignfree (record_buffer[0]);
   alignfree (record_buffer[1]);
+  record_buffer[0] = record_buffer[1] = NULL;
   bufmap_free (NULL);
 }
 
@@ -1787,7 +2080,7 @@ add_multi_volume_header (struct bufmap *map)
 static void
 simple_flush_read (void)
 {
-  checkpoint_run (false);
+  archive_checkpoint (false);
 
   /* Clear the count of errors.  This only applies to a single call to
      flush_read.  */
@@ -1805,7 +2098,8 @@ simple_flush_read (void)
 
   ptrdiff_t nread;
   while ((nread = rmtread (archive, charptr (record_start), record_size)) < 0)
-    archive_read_error ();
+    if (! direct_io_failed ())
+      archive_read_error ();
   short_read_slop = 0;
   if (nread == record_size)
     records_read++;
@@ -1834,7 +2128,7 @@ simple_flush_write (idx_t UNNAMED (level))
 static void
 _gnu_flush_read (void)
 {
-  checkpoint_run (false);
+  archive_checkpoint (false);
 
   /* Clear the count of errors.  This only applies to a single call to
      flush_read.  */
@@ -1853,7 +2147,8 @@ _gnu_flush_read (void)
   ptrdiff_t nread;
   while ((nread = rmtread (archive, charptr (record_start), record_size)) < 0
 	 && ! (errno == ENOSPC && multi_volume_option))
-    archive_read_error ();
+    if (! direct_io_failed ())
+      archive_read_error ();
   /* The condition below used to include
      || (nread > 0 && !read_full_records)
      This is incorrect since even if new_volume() succeeds, the
@@ -22,6 +22,7 @@
 
 #include <wordsplit.h>
 #include <flexmember.h>
+#include <human.h>
 #include <strftime.h>
 
 #include <sys/ioctl.h>
@@ -37,7 +38,8 @@ enum checkpoint_opcode
     cop_sleep,
     cop_exec,
     cop_totals,
-    cop_wait
+    cop_wait,
+    cop_progress
   };
 
 struct checkpoint_action
@@ -49,6 +51,13 @@ struct checkpoint_action
     time_t time;
     char *command;
     int signal;
+    struct
+    {
+      time_t interval;		/* Minimum seconds between reports */
+      struct timespec last;	/* Time of the previous report */
+      tarlong bytes;		/* Bytes transferred by then */
+      intmax_t members;		/* Members processed by then */
+    } progress;
   } v;
   char commandbuf[FLEXIBLE_ARRAY_MEMBER];
 };
@@ -119,6 +128,23 @@ checkpoint_compile_action (const char *str)
     }
   else if (streq (str, "totals"))
     alloc_action (cop_totals, NULL);
+  else if (streq (str, "progress") || strncmp (str, "progress=", 9) == 0)
+    {
+      struct checkpoint_action *act = alloc_action (cop_progress, NULL);
+      act->v.progress.interval = 1;
+      act->v.progress.last.tv_sec = act->v.progress.last.tv_nsec = 0;
+      act->v.progress.bytes = 0;
+      act->v.progress.members = 0;
+      if (str[8])
+	{
+	  char const *arg = str + 9;
+	  char *p;
+	  act->v.progress.interval
+	    = stoint (arg, &p, NULL, 0, TYPE_MAXIMUM (time_t));
+	  if ((p == arg) | *p)
+	    paxfatal (0, _("%s: not a valid interval"), str);
+	}
+    }
   else if (strncmp (str, "wait=", 5) == 0)
     {
       int sig = decode_signal (str + 5);
@@ -387,6 +413,77 @@ format_checkpoint_string (FILE *fp, intmax_t len,
   return len;
 }
 
+/* Print the byte count or rate N, scaled to a human-readable unit.  */
+static void
+print_human (FILE *fp, double n)
+{
+  char abbr[LONGEST_HUMAN_READABLE + 1];
+  int human_opts = human_autoscale | human_base_1024 | human_SI | human_B;
+  if (n < UINTMAX_MAX + 1.0)
+    fputs (human_readable (n, abbr, human_opts, 1, 1), fp);
+  else
+    fprintf (fp, "%g", n);
+}
+
+/* Run the progress action P, unless less than its interval has
+   passed since its last report.  The report gives the bytes
+   transferred, the transfer rate since the previous report and on
+   average, the number of members processed per second and, if the
+   size of the archive being read is known, the percentage done and the
+   estimated time remaining.  */
+static void
+report_progress (struct checkpoint_action *p, bool do_write)
+{
+  struct timespec now = stats_now ();
+  tarlong bytes = (do_write ? total_bytes_written ()
+		   : (tarlong) records_read * record_size);
+  intmax_t members = stats_members ();
+
+  if (p->v.progress.last.tv_sec == 0 && p->v.progress.last.tv_nsec == 0)
+    {
+      /* First checkpoint: start measuring from here.  */
+      p->v.progress.last = now;
+      p->v.progress.bytes = bytes;
+      p->v.progress.members = members;
+      return;
+    }
+
+  double interval = (now.tv_sec - p->v.progress.last.tv_sec
+		     + (now.tv_nsec - p->v.progress.last.tv_nsec) / 1e9);
+  if (interval < p->v.progress.interval || interval <= 0)
+    return;
+
+  double duration = compute_duration_ns () / BILLION;
+  double rate = (bytes - p->v.progress.bytes) / interval;
+  double average = duration > 0 ? bytes / duration : rate;
+  off_t total = do_write ? -1 : archive_input_size ();
+
+  fprintf (stderr, "%s: ", program_name);
+  print_human (stderr, bytes);
+  fprintf (stderr, " %s", do_write ? _("written") : _("read"));
+  if (0 < total)
+    fprintf (stderr, " (%.0f%%)", 100 * min (bytes, total) / (double) total);
+  fputs (", ", stderr);
+  print_human (stderr, rate);
+  fputs (_("/s"), stderr);
+  fputs (_(", average "), stderr);
+  print_human (stderr, average);
+  fputs (_("/s"), stderr);
+  fprintf (stderr, _(", %.1f files/s"),
+	   (members - p->v.progress.members) / interval);
+  if (0 < total && 0 < average)
+    {
+      intmax_t eta = total <= bytes ? 0 : (total - bytes) / average + 0.5;
+      fprintf (stderr, _(", ETA %jd:%02d:%02d"),
+	       eta / 3600, (int) (eta / 60 % 60), (int) (eta % 60));
+    }
+  fputc ('\n', stderr);
+
+  p->v.progress.last = now;
+  p->v.progress.bytes = bytes;
+  p->v.progress.members = members;
+}
+
 static FILE *tty = NULL;
 
 static void
@@ -450,6 +547,11 @@ run_checkpoint_actions (bool do_write)
 	    int n;
 	    sigwait (&sigs, &n);
 	  }
+	  break;
+
+	case cop_progress:
+	  report_progress (p, do_write);
+	  break;
 	}
     }
 }
@@ -479,11 +581,18 @@ checkpoint_flush_actions (void)
     }
 }
 
+/* Count RECORDS more records read or written, and run the checkpoint
+   actions if a checkpoint is among them.  */
 void
-checkpoint_run (bool do_write)
+checkpoint_run (bool do_write, intmax_t records)
 {
-  if (checkpoint_option && !(++checkpoint % checkpoint_option))
-    run_checkpoint_actions (do_write);
+  if (checkpoint_option)
+    {
+      intmax_t prev = checkpoint;
+      checkpoint += records;
+      if (prev / checkpoint_option != checkpoint / checkpoint_option)
+	run_checkpoint_actions (do_write);
+    }
 }
 
 void
@@ -59,6 +59,7 @@ enum
 #include <progname.h>
 #include <quote.h>
 #include <safe-read.h>
+#include <savedir.h>
 #include <stat-time.h>
 #include <timespec.h>
 #include <verify.h>
@@ -102,6 +103,11 @@ extern enum archive_format archive_format;
 extern idx_t blocking_factor;
 extern idx_t record_size;
 
+/* If true, --record-size=auto: the record size above is that of the
+   archive on the media, and the archive is read and written in larger
+   records when its type allows.  */
+extern bool auto_record_size_option;
+
 extern bool absolute_names_option;
 
 /* Display file times in UTC */
@@ -193,6 +199,10 @@ extern bool keep_directory_symlink_option;
 extern const char *listed_incremental_option;
 /* Incremental dump level: either -1, 0, or 1.  */
 extern signed char incremental_level;
+/* File listing the files changed since the last incremental dump.  */
+extern char const *changed_files_option;
+/* Append changes to the snapshot file instead of rewriting it.  */
+extern bool snapshot_journal_option;
 /* Check device numbers when doing incremental dumps. */
 extern bool check_device_option;
 
@@ -204,6 +214,18 @@ extern mode_t initial_umask;
 
 extern bool multi_volume_option;
 
+/* Treat each archive named with -f as a separate archive, rather than
+   as a volume of a multi-volume archive.  */
+extern bool separate_archives_option;
+
+/* With --separate-archives, file recording which archive each file
+   name given to tar -c went to.  */
+extern char const *manifest_option;
+
+/* With --separate-archives, the number of archives of an incremental
+   chain that may be extracted at once.  */
+extern idx_t jobs_option;
+
 /* Specified threshold date and time.  Files having an older time stamp
    do not get archived (also see after_date_option above).  */
 extern struct timespec newer_mtime_option;
@@ -254,6 +276,22 @@ extern bool recursive_unlink_option;
 
 extern bool read_full_records_option;
 
+/* If nonzero, read the archive in a child process that may get this
+   many bytes ahead of the member being processed.  */
+extern idx_t read_ahead_option;
+
+/* If true, ask the system to drop the data of member files and of the
+   archive from the page cache once they have been processed.  */
+extern bool drop_cache_option;
+
+/* If nonzero, start reading this many directory entries ahead of the
+   file being archived.  */
+extern idx_t prefetch_option;
+
+/* If true, bypass the page cache when reading or writing an archive
+   that is a regular file.  */
+extern bool direct_io_option;
+
 extern bool remove_files_option;
 
 /* Specified remote shell command.  */
@@ -307,6 +345,19 @@ extern bool to_stdout_option;
 
 extern bool totals_option;
 
+/* If true, --totals prints the detailed performance counters too.  */
+extern bool detailed_totals_option;
+
+/* Name of the file to write performance counters to, or NULL.  */
+extern char const *stats_file_option;
+
+/* True if performance counters are being collected.  */
+extern bool stats_option;
+
+/* If nonzero, the number of bytes the structures counted by
+   stats_alloc may use before tar starts to do without them.  */
+extern idx_t memory_limit_option;
+
 extern bool touch_option;
 
 extern char *to_command_option;
@@ -383,8 +434,14 @@ extern int seek_option;
 /* Unquote filenames */
 extern bool unquote_option;
 
+/* Order of directory entries, from enum savedir_option or
+   SAVEDIR_SORT_EXTENT.  */
 extern int savedir_sort_order;
 
+/* --sort=extent orders the entries by the physical position of their
+   data, which savedir cannot do by itself.  */
+enum { SAVEDIR_SORT_EXTENT = SAVEDIR_SORT_INODE + 1 };
+
 /* Show file or archive names after transformation.
    In particular, when creating archive in verbose mode, list member names
    as stored in the archive */
@@ -459,6 +516,7 @@ char *drop_volume_label_suffix (const char *label)
   _GL_ATTRIBUTE_MALLOC _GL_ATTRIBUTE_DEALLOC_FREE;
 
 idx_t available_space_after (union block *pointer);
+bool fits_in_record (union block *pointer, off_t size);
 off_t current_block_ordinal (void);
 void close_archive (void);
 void closeout_volume_number (void);
@@ -470,6 +528,8 @@ void flush_archive (void);
 void init_volume_number (void);
 void open_archive (enum access_mode mode);
 void print_total_stats (void);
+tarlong total_bytes_written (void);
+off_t archive_input_size (void);
 void reset_eof (void);
 void set_next_block_after (void *);
 void clear_read_error_count (void);
@@ -564,6 +624,7 @@ void extract_finish (void);
 bool rename_directory (char *src, char *dst);
 
 void remove_delayed_set_stat (const char *fname);
+void forget_delayed_set_stat (void);
 
 /* Module delete.c.  */
 
@@ -577,6 +638,8 @@ void delete_archive_members (void);
 struct directory *scan_directory (struct tar_stat_info *st);
 const char *directory_contents (struct directory *dir);
 const char *safe_directory_contents (struct directory *dir);
+bool directory_entry_stat (struct directory *dir, char const *name,
+			   struct stat *st);
 
 void rebase_directory (struct directory *dir,
 		       const char *samp, idx_t slen,
@@ -585,8 +648,26 @@ void rebase_directory (struct directory *dir,
 void append_incremental_renames (struct directory *dir);
 void show_snapshot_field_ranges (void);
 void read_directory_file (void);
+void read_changed_files (idx_t cdidx);
 void write_directory_file (void);
 void purge_directory (char const *directory_name);
+
+/* The members a restore plan extracts.  */
+enum restore_phase
+  {
+    RESTORE_ALL,		/* all members */
+    RESTORE_DIRECTORIES,	/* directories only */
+    RESTORE_FILES		/* all but directories */
+  };
+
+bool restore_plan_wanted (char const *const *names, idx_t count);
+void restore_plan_archive (idx_t archive);
+void restore_plan_note (void);
+bool restore_plan_finish (bool complete);
+bool restore_plan_parallel_p (void);
+void restore_plan_phase (enum restore_phase phase);
+void restore_plan_free (void);
+bool restore_plan_skip (char const *name, bool directory);
 void list_dumpdir (char *buffer, idx_t size);
 void update_parent_directory (struct tar_stat_info *st);
 
@@ -681,6 +762,7 @@ void normalize_filename_x (char *name);
 void replace_prefix (char **pname, const char *samp, idx_t slen,
 		     const char *repl, idx_t rlen);
 char *tar_savedir (const char *name, bool must_exist);
+char *sorted_streamsavedir (DIR *dir);
 
 typedef struct namebuf *namebuf_t;
 namebuf_t namebuf_create (const char *dir);
@@ -773,6 +855,25 @@ bool maybe_backup_file (const char *file_name, bool this_is_the_archive);
 void undo_last_backup (void);
 
 int deref_stat (char const *name, struct stat *buf);
+int deref_fstatat (int fd, char const *name, struct stat *buf);
+
+/* Members of struct stat needed by a caller of fstatat_fields and the
+   like.  st_dev and st_rdev are always filled in.  */
+enum
+  {
+    STAT_TYPE = 1 << 0,		/* File type bits of st_mode */
+    STAT_MTIME = 1 << 1,	/* Modification time */
+    STAT_CTIME = 1 << 2,	/* Status change time */
+    STAT_INO = 1 << 3,		/* Inode number */
+    STAT_MODE = 1 << 4,		/* All of st_mode */
+    STAT_SIZE = 1 << 5,		/* Size */
+    STAT_ALL = -1		/* Everything */
+  };
+int fstatat_fields (int fd, char const *name, struct stat *buf, int flags,
+		    int fields);
+int deref_fstatat_fields (int fd, char const *name, struct stat *buf,
+			  int fields);
+int fstat_fields (int fd, struct stat *buf, int fields);
 
 idx_t blocking_read (int fd, void *buf, idx_t count);
 idx_t blocking_write (int fd, void const *buf, idx_t count);
@@ -831,15 +932,18 @@ void gid_to_gname (gid_t gid, char **gname);
 bool gname_to_gid (char const *gname, gid_t *pgid);
 void uid_to_uname (uid_t uid, char **uname);
 bool uname_to_uid (char const *uname, uid_t *puid);
+void preload_id_caches (void);
 
 void name_init (void);
 void name_add_name (const char *name);
 char const *name_next (bool);
+bool name_list_reads_stdin (void);
 void name_gather (void);
 struct name *addname (char const *, idx_t, bool, struct name *);
 void add_starting_file (char const *file_name);
 void remname (struct name *name);
 bool name_match (const char *name);
+bool name_list_selects_all (void);
 void names_notfound (void);
 void label_notfound (void);
 void collect_and_sort_names (void);
@@ -876,6 +980,9 @@ bool confirm (const char *message_action, const char *name);
 void tar_stat_init (struct tar_stat_info *st);
 bool tar_stat_close (struct tar_stat_info *st);
 void tar_stat_destroy (struct tar_stat_info *st);
+char *tar_stat_strndup (struct tar_stat_info *st, char const *p, idx_t n);
+void tar_stat_assign_n (struct tar_stat_info *st, char **pstr,
+			char const *value, idx_t n);
 _Noreturn void usage (int);
 int tar_timespec_cmp (struct timespec a, struct timespec b);
 const char *archive_format_string (enum archive_format fmt);
@@ -938,6 +1045,7 @@ void xheader_decode_global (struct xheader *xhdr);
 void xheader_store (char const *keyword, struct tar_stat_info *st,
 		    void const *data);
 void xheader_read (struct xheader *xhdr, union block *header, off_t size);
+void xheader_keep (struct xheader *xhdr);
 void xheader_write (char type, char *name, time_t t, struct xheader *xhdr);
 void xheader_write_global (struct xheader *xhdr);
 void xheader_forbid_global (void);
@@ -959,6 +1067,8 @@ void xattr_map_copy (struct xattr_map *dst,
 		     const struct xattr_map *src);
 void xattr_map_add (struct xattr_map *map,
 		    const char *key, const char *val, idx_t len);
+void xattr_map_append (struct xattr_map *map, char *key, char *val,
+		       idx_t len);
 void xattr_map_free (struct xattr_map *xattr_map);
 
 /* Module system.c */
@@ -968,6 +1078,7 @@ extern bool dev_null_output;
 
 void sys_detect_dev_null_output (void);
 void sys_wait_for_child (pid_t, bool);
+void sys_wait_for_shard (pid_t);
 void sys_spawn_shell (void);
 bool sys_compare_uid (struct stat *a, struct stat *b);
 bool sys_compare_gid (struct stat *a, struct stat *b);
@@ -975,6 +1086,13 @@ bool sys_file_is_archive (struct tar_stat_info *p);
 int sys_truncate (int fd);
 pid_t sys_child_open_for_compress (void);
 pid_t sys_child_open_for_uncompress (void);
+pid_t sys_child_open_for_read_ahead (idx_t size);
+void sys_advise_sequential (int fd);
+void sys_drop_cache (int fd, off_t offset, off_t len);
+void sys_drop_written_cache (int fd);
+void sys_drop_written_cache_finish (void);
+void sys_prefetch_file (int dirfd, char const *name, off_t size);
+bool sys_set_direct_io (int fd, bool on);
 idx_t sys_write_archive_buffer (void);
 bool sys_get_archive_stat (void);
 int sys_exec_command (char *file_name, char typechar, struct tar_stat_info *st);
@@ -1028,10 +1146,59 @@ char *strip_compression_suffix (const char *name);
 /* Module checkpoint.c */
 void checkpoint_compile_action (const char *str);
 void checkpoint_finish_compile (void);
-void checkpoint_run (bool do_write);
+void checkpoint_run (bool do_write, intmax_t records);
 void checkpoint_finish (void);
 void checkpoint_flush_actions (void);
 
+/* Module stats.c */
+enum stats_timer
+  {
+    STATS_FLUSH_ARCHIVE,	/* flush_archive: archive and compressor I/O */
+    STATS_FILE_READ,		/* blocking_read: member file reads */
+    STATS_FILE_WRITE,		/* blocking_write: member file writes */
+    STATS_STAT,			/* fstatat of member files */
+    STATS_SAVEDIR,		/* reading directory contents */
+    STATS_XATTR,		/* xattr, ACL and SELinux calls */
+    STATS_TIMERS
+  };
+
+/* Data structures whose size grows with the number of files.  */
+enum stats_memory
+  {
+    STATS_MEM_NAMES,		/* names.c: the name list */
+    STATS_MEM_DIRECTORIES,	/* incremen.c: directories and their contents */
+    STATS_MEM_LINKS,		/* create.c: the hard link table */
+    STATS_MEM_DELAYED,		/* extract.c: delayed metadata and links */
+    STATS_MEMORY
+  };
+
+struct timespec stats_now (void);
+void stats_record (enum stats_timer timer, struct timespec start);
+void stats_alloc (enum stats_memory mem, idx_t size);
+void stats_free (enum stats_memory mem, idx_t size);
+bool memory_limit_reached (void);
+void stats_count_member (void);
+intmax_t stats_members (void);
+void print_detailed_stats (FILE *fp);
+void write_stats_file (void);
+
+/* Return the start time for a call to be measured with stats_stop,
+   or a dummy value if no counters are being collected.  */
+COMMON_INLINE struct timespec
+stats_start (void)
+{
+  return stats_option ? stats_now () : (struct timespec) { 0 };
+}
+
+/* Account the time elapsed since START, as returned by stats_start,
+   to TIMER.  */
+COMMON_INLINE void
+stats_stop (enum stats_timer timer, struct timespec start)
+{
+  if (stats_option)
+    stats_record (timer, start);
+}
+
 /* Module warning.c */
 enum
   {
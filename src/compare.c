@@ -43,14 +43,16 @@ bool now_verifying;
 /* File descriptor for the file we are diffing.  */
 static int diff_handle;
 
-/* Area for reading file contents into.  */
+/* Area for reading file contents into, and its size.  */
 static char *diff_buffer;
+static idx_t diff_buffer_size;
 
 /* Initialize for a diff operation.  */
 void
 diff_init (void)
 {
   diff_buffer = xalignalloc (getpagesize (), record_size);
+  diff_buffer_size = record_size;
   if (listed_incremental_option)
     read_directory_file ();
 }
@@ -86,6 +88,15 @@ process_noop (idx_t UNNAMED (size), char *UNNAMED (data))
 static bool
 process_rawdata (idx_t bytes, char *buffer)
 {
+  /* With --record-size=auto, the archive may be read in records larger
+     than when the buffer was allocated.  */
+  if (diff_buffer_size < bytes)
+    {
+      alignfree (diff_buffer);
+      diff_buffer = xalignalloc (getpagesize (), record_size);
+      diff_buffer_size = record_size;
+    }
+
   idx_t status = blocking_read (diff_handle, diff_buffer, bytes);
 
   if (status < bytes)
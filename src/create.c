@@ -33,12 +33,27 @@
    Pretend the impostor isn't there.  */
 enum { IMPOSTOR_ERRNO = ENOENT };
 
+/* A directory part shared by the names of hard-linked files.  */
+struct link_dir
+  {
+    char *name;			/* Up to and including the last slash */
+    idx_t len;			/* Length of NAME */
+    idx_t refs;			/* Number of link names using it */
+  };
+
+/* The name a hard-linked file was archived under.  */
+struct link_name
+  {
+    struct link_dir *dir;	/* Directory part, or null if none */
+    char base[FLEXIBLE_ARRAY_MEMBER]; /* The rest of the name */
+  };
+
 struct link
   {
     dev_t st_dev;
     ino_t st_ino;
-    nlink_t nlink;
-    char name[FLEXIBLE_ARRAY_MEMBER];
+    nlink_t nlink;		/* Links not seen yet */
+    struct link_name *name;	/* Null if this slot of link_table is free */
   };
 
 struct exclusion_tag
@@ -142,12 +157,49 @@ max_octal_val (int bufsize)
    Output to buffer WHERE with size SIZE.
    The result is undefined if SIZE is 0 or if VALUE is too large to fit.  */
 
+/* Return the eight octal digit characters of V, which must be less
+   than 8**8, in a word whose most significant byte is the first
+   digit.  Each step splits all lanes of the word in two at once.  */
+static uint_fast64_t
+octal_word (uint_fast64_t v)
+{
+  uint_fast64_t w = (v >> 12) << 32 | (v & 07777);
+  w = (w & 0x00000FC000000FC0) << 10 | (w & 0x0000003F0000003F);
+  w = (w & 0x0038003800380038) << 5 | (w & 0x0007000700070007);
+  return w + 0x3030303030303030;
+}
+
+/* Store the last N bytes of the word W at WHERE, most significant
+   first.  */
+static void
+store_octal_word (uint_fast64_t w, char *where, int n)
+{
+  for (int i = n; 0 < i; i--)
+    {
+      where[i - 1] = w & 0xFF;
+      w >>= 8;
+    }
+}
+
 static void
 to_octal (uintmax_t value, char *where, int size)
 {
   uintmax_t v = value;
   int i = size;
 
+  /* Fast path for the 8- and 12-byte fields that hold most values.  */
+  if (size == 7)
+    {
+      store_octal_word (octal_word (v), where, 7);
+      return;
+    }
+  if (size == 11)
+    {
+      store_octal_word (octal_word (v >> 24), where, 3);
+      store_octal_word (octal_word (v & 077777777), where + 3, 8);
+      return;
+    }
+
   do
     {
       where[--i] = '0' + v % 8;
@@ -1079,6 +1131,23 @@ dump_regular_file (int fd, struct tar_stat_info *st)
 }
 
 
+/* With --prefetch, at most this many bytes of a file are read ahead
+   of time; the system reads the rest ahead as the file is archived.  */
+enum { PREFETCH_SIZE_MAX = 1024 * 1024 };
+
+/* Start reading the file NAME in the directory DIR, if it is a regular
+   file, so that its data are at hand when it is archived.  */
+static void
+prefetch_file (struct tar_stat_info const *dir, char const *name)
+{
+  struct stat st;
+  if (0 < dir->fd
+      && fstatat_fields (dir->fd, name, &st, AT_SYMLINK_NOFOLLOW,
+			 STAT_TYPE | STAT_SIZE) == 0
+      && S_ISREG (st.st_mode) && 0 < st.st_size)
+    sys_prefetch_file (dir->fd, name, min (st.st_size, PREFETCH_SIZE_MAX));
+}
+
 /* Copy info from the directory identified by ST into the archive.
    DIRECTORY contains the directory's entries.  */
 
@@ -1175,12 +1244,33 @@ dump_dir0 (struct tar_stat_info *st, char const *directory)
 	    name_buf = xstrdup (st->orig_file_name);
 	    idx_t name_len = name_size = strlen (name_buf);
 
+	    /* With --prefetch, the entries from ENTRY up to AHEAD, of
+	       which there are AHEAD_COUNT, have been prefetched.  */
+	    char const *ahead = directory;
+	    idx_t ahead_count = 0;
+
 	    /* Now output all the files in the directory.  */
 	    idx_t entry_len;
 	    for (char const *entry = directory;
 		 (entry_len = strlen (entry)) != 0;
 		 entry += entry_len + 1)
 	      {
+		if (prefetch_option)
+		  {
+		    /* ENTRY itself is about to be read anyway.  */
+		    if (ahead == entry)
+		      {
+			ahead += entry_len + 1;
+			ahead_count = 1;
+		      }
+		    for (; ahead_count <= prefetch_option && *ahead;
+			 ahead_count++)
+		      {
+			prefetch_file (st, ahead);
+			ahead += strlen (ahead) + 1;
+		      }
+		    ahead_count--;
+		  }
 		if (name_size < name_len + entry_len)
 		  {
 		    name_size = name_len + entry_len;
@@ -1266,7 +1356,10 @@ get_directory_entries (struct tar_stat_info *st)
   while (! (st->dirstream = fdopendir (st->fd)))
     if (! open_failure_recover (st))
       return NULL;
-  return streamsavedir (st->dirstream, savedir_sort_order);
+  struct timespec start = stats_start ();
+  char *entries = sorted_streamsavedir (st->dirstream);
+  stats_stop (STATS_SAVEDIR, start);
+  return entries;
 }
 
 /* Dump the directory ST.  Return true if successful, false (emitting
@@ -1298,11 +1391,90 @@ static nlink_t trivial_link_count;
 
 /* Main functions of this module.  */
 
+/* With --separate-archives, the index of the archive this process
+   creates, and the number of archives.  */
+static idx_t shard_index;
+static idx_t shard_count = 1;
+
+/* Stream for --manifest, shared by all processes.  */
+static FILE *manifest;
+
+/* Create each of the archives named with -f in a child process of its
+   own.  Return true in the children, set up to create their archive,
+   and false in the parent, once all of them have exited.  */
+static bool
+fork_shards (void)
+{
+  idx_t count = archive_names;
+  pid_t *pids = xinmalloc (count, sizeof *pids);
+
+  if (manifest_option)
+    {
+      /* Each child appends whole lines, so that theirs do not mix.  */
+      int fd = open (manifest_option,
+		     O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, MODE_RW);
+      if (fd < 0 || ! (manifest = fdopen (fd, "w")))
+	open_fatal (manifest_option);
+      setvbuf (manifest, NULL, _IOLBF, 0);
+    }
+
+  /* Nothing has been listed yet: make the children's listings go out
+     a line at a time, so that they do not mix either.  */
+  setvbuf (stdlis, NULL, _IOLBF, 0);
+  fflush (NULL);
+  for (idx_t i = 0; i < count; i++)
+    {
+      pid_t pid = xfork ();
+      if (pid == 0)
+	{
+	  free (pids);
+	  archive_name_array = archive_name_cursor = archive_name_array + i;
+	  archive_names = 1;
+	  shard_index = i;
+	  shard_count = count;
+	  if (stats_file_option)
+	    {
+	      char *name = xmalloc (strlen (stats_file_option)
+				    + INT_BUFSIZE_BOUND (intmax_t) + 1);
+	      sprintf (name, "%s.%jd", stats_file_option, intmax (i));
+	      stats_file_option = name;
+	    }
+	  return true;
+	}
+      pids[i] = pid;
+    }
+
+  for (idx_t i = 0; i < count; i++)
+    sys_wait_for_shard (pids[i]);
+  free (pids);
+
+  if (manifest && fclose (manifest) != 0)
+    close_error (manifest_option);
+
+  /* Each child has reported its own totals.  */
+  totals_option = false;
+  return false;
+}
+
+/* Record in the manifest that NAME goes to this process's archive.  */
+static void
+add_to_manifest (char const *name)
+{
+  fprintf (manifest, "%s\t%s\n", quotearg_n (0, archive_name_array[0]),
+	   quotearg_n (1, name));
+}
+
+static void dump_scanned_file (struct tar_stat_info *, char const *,
+			       char const *, struct stat const *);
+
 void
 create_archive (void)
 {
   struct name const *p;
 
+  if (separate_archives_option && !fork_shards ())
+    return;
+
   trivial_link_count = filename_args != FILES_MANY && ! dereference_option;
 
   open_archive (ACCESS_WRITE);
@@ -1362,7 +1534,11 @@ create_archive (void)
 			buffer = xpalloc (buffer, &buffer_size,
 					  plen + qlen - buffer_size, -1, 1);
 		      strcpy (buffer + plen, q + 1);
-		      dump_file (&st, q + 1, buffer);
+		      struct stat scanned;
+		      bool known = directory_entry_stat (p->directory, q + 1,
+							 &scanned);
+		      dump_scanned_file (&st, q + 1, buffer,
+					 known ? &scanned : NULL);
 		    }
 		  q += qlen + 1;
 		}
@@ -1373,9 +1549,16 @@ create_archive (void)
   else
     {
       const char *name;
-      while ((name = name_next (true)))
-	if (!excluded_name (name, NULL))
-	  dump_file (NULL, name, name);
+
+      /* With --separate-archives, hand out the names to the archives
+	 in turn.  */
+      for (idx_t i = 0; (name = name_next (true)); i++)
+	if (i % shard_count == shard_index && !excluded_name (name, NULL))
+	  {
+	    if (manifest)
+	      add_to_manifest (name);
+	    dump_file (NULL, name, name);
+	  }
     }
 
   write_eot ();
@@ -1383,25 +1566,29 @@ create_archive (void)
   finish_deferred_unlinks ();
   if (listed_incremental_option)
     write_directory_file ();
+  if (manifest && fclose (manifest) != 0)
+    write_error (manifest_option);
 }
 
 
-/* Calculate the hash of a link.  */
+/* Calculate the hash of a link directory.  */
 static size_t
-hash_link (void const *entry, size_t n_buckets)
+hash_link_dir (void const *entry, size_t n_buckets)
 {
-  struct link const *l = entry;
-  uintmax_t num = l->st_dev ^ l->st_ino;
-  return num % n_buckets;
+  struct link_dir const *dir = entry;
+  size_t h = 0;
+  for (idx_t i = 0; i < dir->len; i++)
+    h = h * 31 + (unsigned char) dir->name[i];
+  return h % n_buckets;
 }
 
-/* Compare two links for equality.  */
+/* Compare two link directories for equality.  */
 static bool
-compare_links (void const *entry1, void const *entry2)
+compare_link_dirs (void const *entry1, void const *entry2)
 {
-  struct link const *link1 = entry1;
-  struct link const *link2 = entry2;
-  return PSAME_INODE (link1, link2);
+  struct link_dir const *dir1 = entry1;
+  struct link_dir const *dir2 = entry2;
+  return dir1->len == dir2->len && memeq (dir1->name, dir2->name, dir1->len);
 }
 
 static void
@@ -1416,37 +1603,183 @@ unknown_file_error (char const *p)
 
 /* Handling of hard links */
 
-/* Table of all non-directories that we've written so far.  Any time
-   we see another, we check the table and avoid dumping the data
-   again if we've done it once already.  */
-static Hash_table *link_table;
+/* Table of all non-directories with several links that we've written
+   so far.  Any time we see another, we check the table and avoid
+   dumping the data again if we've done it once already.  The table
+   is open-addressed with linear probing; its size is a power of 2 and
+   it is kept at most half full.  Once all the links to a file have
+   been seen, its entry is removed, unless the link counts cannot be
+   trusted to say that (trivial_link_count is 0).  */
+static struct link *link_table;
+static idx_t link_table_size;
+static idx_t link_table_used;
+
+/* Table of the directory parts of the names in link_table.  */
+static Hash_table *link_dir_table;
+
+/* Return the slot where the link to DEV and INO would start its
+   search.  */
+static idx_t
+link_home (dev_t dev, ino_t ino)
+{
+  uintmax_t h = (ino ^ ((uintmax_t) dev << 16)) * 0x9E3779B97F4A7C15u;
+  return (h ^ (h >> 32)) & (link_table_size - 1);
+}
+
+/* Return the slot of link_table holding the link to DEV and INO, or
+   the free slot where it would go.  */
+static struct link *
+find_link (dev_t dev, ino_t ino)
+{
+  idx_t mask = link_table_size - 1;
+  for (idx_t i = link_home (dev, ino); ; i = (i + 1) & mask)
+    {
+      struct link *lp = &link_table[i];
+      if (!lp->name || (lp->st_dev == dev && lp->st_ino == ino))
+	return lp;
+    }
+}
+
+/* Make room in link_table for one more link.  */
+static void
+grow_link_table (void)
+{
+  if (2 * (link_table_used + 1) <= link_table_size)
+    return;
+
+  struct link *old = link_table;
+  idx_t old_size = link_table_size;
+  link_table_size = old_size ? 2 * old_size : 1024;
+  link_table = xicalloc (link_table_size, sizeof *link_table);
+  stats_alloc (STATS_MEM_LINKS, link_table_size * sizeof *link_table);
+  for (idx_t i = 0; i < old_size; i++)
+    if (old[i].name)
+      *find_link (old[i].st_dev, old[i].st_ino) = old[i];
+  free (old);
+  stats_free (STATS_MEM_LINKS, old_size * sizeof *old);
+}
+
+/* Return a new link name for NAME, sharing its directory part with the
+   other link names in the same directory.  */
+static struct link_name *
+make_link_name (char const *name)
+{
+  char const *slash = strrchr (name, '/');
+  char const *base = slash ? slash + 1 : name;
+  idx_t size = FLEXNSIZEOF (struct link_name, base, strlen (base) + 1);
+  struct link_name *ln = xmalloc (size);
+  strcpy (ln->base, base);
+  ln->dir = NULL;
+  stats_alloc (STATS_MEM_LINKS, size);
+
+  if (slash)
+    {
+      struct link_dir key = { .name = (char *) name, .len = base - name };
+      if (! (link_dir_table
+	     || (link_dir_table = hash_initialize (0, NULL, hash_link_dir,
+						   compare_link_dirs, NULL))))
+	xalloc_die ();
+      ln->dir = hash_lookup (link_dir_table, &key);
+      if (!ln->dir)
+	{
+	  ln->dir = xmalloc (sizeof *ln->dir);
+	  ln->dir->name = ximemdup (name, key.len);
+	  ln->dir->len = key.len;
+	  ln->dir->refs = 0;
+	  if (!hash_insert (link_dir_table, ln->dir))
+	    xalloc_die ();
+	  stats_alloc (STATS_MEM_LINKS, sizeof *ln->dir + key.len);
+	}
+      ln->dir->refs++;
+    }
+  return ln;
+}
+
+static void
+free_link_name (struct link_name *ln)
+{
+  struct link_dir *dir = ln->dir;
+  if (dir && --dir->refs == 0)
+    {
+      hash_remove (link_dir_table, dir);
+      stats_free (STATS_MEM_LINKS, sizeof *dir + dir->len);
+      free (dir->name);
+      free (dir);
+    }
+  stats_free (STATS_MEM_LINKS,
+	      FLEXNSIZEOF (struct link_name, base, strlen (ln->base) + 1));
+  free (ln);
+}
+
+/* Return the full name recorded in LN.  The result is valid until the
+   next call.  */
+static char const *
+link_name_string (struct link_name const *ln)
+{
+  static char *buffer;
+  static idx_t buffer_size;
+
+  if (!ln->dir)
+    return ln->base;
+
+  idx_t len = ln->dir->len + strlen (ln->base) + 1;
+  if (buffer_size < len)
+    buffer = xpalloc (buffer, &buffer_size, len - buffer_size, -1, 1);
+  memcpy (buffer, ln->dir->name, ln->dir->len);
+  strcpy (buffer + ln->dir->len, ln->base);
+  return buffer;
+}
+
+/* Remove the link in slot LP of link_table.  Move later links of the
+   same probe sequence back into the hole, so that no search stops
+   short of them.  */
+static void
+remove_link (struct link *lp)
+{
+  idx_t mask = link_table_size - 1;
+  idx_t i = lp - link_table;
+
+  free_link_name (lp->name);
+  for (idx_t j = (i + 1) & mask; link_table[j].name; j = (j + 1) & mask)
+    {
+      idx_t k = link_home (link_table[j].st_dev, link_table[j].st_ino);
+      if (((j - k) & mask) >= ((j - i) & mask))
+	{
+	  link_table[i] = link_table[j];
+	  i = j;
+	}
+    }
+  link_table[i].name = NULL;
+  link_table_used--;
+}
 
 /* Try to dump stat as a hard link to another file in the archive.
    Return true if successful.  */
 static bool
 dump_hard_link (struct tar_stat_info *st)
 {
-  if (link_table
+  if (link_table_used
       && (trivial_link_count < st->stat.st_nlink || remove_files_option))
     {
-      struct link lp;
       struct link *duplicate;
       off_t block_ordinal;
       union block *blk;
 
-      lp.st_dev = st->stat.st_dev;
-      lp.st_ino = st->stat.st_ino;
-
-      if ((duplicate = hash_lookup (link_table, &lp)))
+      duplicate = find_link (st->stat.st_dev, st->stat.st_ino);
+      if (duplicate->name)
 	{
 	  /* We found a link.  */
-	  char const *link_name = safer_name_suffix (duplicate->name, true,
-	                                             absolute_names_option);
-	  if (duplicate->nlink)
-	    duplicate->nlink--;
+	  char const *link_name;
+
+	  assign_string (&st->link_name,
+			 safer_name_suffix (link_name_string (duplicate->name),
+					    true, absolute_names_option));
+	  link_name = st->link_name;
+	  if (duplicate->nlink && --duplicate->nlink == 0
+	      && trivial_link_count)
+	    remove_link (duplicate);
 
 	  block_ordinal = current_block_ordinal ();
-	  assign_string (&st->link_name, link_name);
 	  if (NAME_FIELD_SIZE - (archive_format == OLDGNU_FORMAT)
 	      < strlen (link_name))
 	    write_long_link (st);
@@ -1476,9 +1809,20 @@ file_count_links (struct tar_stat_info *st)
     return;
   if (trivial_link_count < st->stat.st_nlink)
     {
-      struct link *duplicate;
       char *linkname = NULL;
       struct link *lp;
+      static bool warned;
+
+      /* Over the memory limit, stop recording files, so that their
+	 other links are archived with their contents again.  */
+      if (memory_limit_reached ())
+	{
+	  if (!warned)
+	    paxwarn (0, _("Memory limit reached; links to further files"
+			  " will be archived as separate files"));
+	  warned = true;
+	  return;
+	}
 
       assign_string (&linkname, safer_name_suffix (st->orig_file_name, true,
 						   absolute_names_option));
@@ -1488,22 +1832,16 @@ file_count_links (struct tar_stat_info *st)
 	  return;
 	}
 
-      lp = xmalloc (FLEXNSIZEOF (struct link, name, strlen (linkname) + 1));
+      grow_link_table ();
+      lp = find_link (st->stat.st_dev, st->stat.st_ino);
+      if (lp->name)
+	abort ();
       lp->st_dev = st->stat.st_dev;
       lp->st_ino = st->stat.st_ino;
-      lp->nlink = st->stat.st_nlink;
-      strcpy (lp->name, linkname);
+      lp->nlink = st->stat.st_nlink - 1;
+      lp->name = make_link_name (linkname);
+      link_table_used++;
       free (linkname);
-
-      if (! ((link_table
-	      || (link_table = hash_initialize (0, NULL, hash_link,
-						compare_links, NULL)))
-	     && (duplicate = hash_insert (link_table, lp))))
-	xalloc_die ();
-
-      if (duplicate != lp)
-	abort ();
-      lp->nlink--;
     }
 }
 
@@ -1512,13 +1850,10 @@ file_count_links (struct tar_stat_info *st)
 void
 check_links (void)
 {
-  if (!link_table)
-    return;
-
-  for (struct link *lp = hash_get_first (link_table); lp;
-       lp = hash_get_next (link_table, lp))
-    if (lp->nlink)
-      paxwarn (0, _("Missing links to %s."), quote (lp->name));
+  for (idx_t i = 0; i < link_table_size; i++)
+    if (link_table[i].name && link_table[i].nlink)
+      paxwarn (0, _("Missing links to %s."),
+	       quote (link_name_string (link_table[i].name)));
 }
 
 /* Assuming DIR is the working directory, open FILE, using FLAGS to
@@ -1572,7 +1907,7 @@ restore_parent_fd (struct tar_stat_info const *st)
 
       if (parentfd < 0)
 	parentfd = - errno;
-      else if (fstat (parentfd, &parentstat) < 0
+      else if (fstat_fields (parentfd, &parentstat, STAT_INO) < 0
 	       || !psame_inode (&parent->stat, &parentstat))
 	{
 	  close (parentfd);
@@ -1584,7 +1919,7 @@ restore_parent_fd (struct tar_stat_info const *st)
 	  int origfd = open_searchdir (parent->orig_file_name);
 	  if (0 <= origfd)
 	    {
-	      if (fstat (origfd, &parentstat) < 0
+	      if (fstat_fields (origfd, &parentstat, STAT_INO) < 0
 		  || !psame_inode (&parent->stat, &parentstat))
 		close (origfd);
 	      else
@@ -1596,9 +1931,50 @@ restore_parent_fd (struct tar_stat_info const *st)
     }
 }
 
+/* Get the SELinux context and extended attributes of the file F whose
+   status is in ST, and its ACLs too if ACLS.  FD is the file's
+   descriptor, or 0 if it is not open.  XISFILE is passed on to
+   xattrs_acls_get.  */
+static void
+get_file_xattrs (struct fdbase f, struct tar_stat_info *st, int fd,
+		 bool acls, bool xisfile)
+{
+  struct timespec start = stats_start ();
+  if (acls)
+    xattrs_acls_get (f.fd, f.base, st, xisfile);
+  xattrs_selinux_get (f.fd, f.base, st, fd);
+  xattrs_xattrs_get (f.fd, f.base, st, fd);
+  stats_stop (STATS_XATTR, start);
+}
+
+/* Set *ST to the status of the file NAME in the directory FD, which
+   scan_directory found to be *SCANNED.  The file may have changed
+   since the scan, so check that it is still the same inode with the
+   same status change time, which any change to its data or attributes
+   updates, and look it up in full if not.  Return 0 if successful,
+   -1 (setting errno) otherwise.  */
+static int
+scanned_fstatat (int fd, char const *name, struct stat const *scanned,
+		 struct stat *st)
+{
+  struct stat now;
+  if (deref_fstatat_fields (fd, name, &now, STAT_INO | STAT_CTIME) < 0)
+    return -1;
+  if (now.st_ino == scanned->st_ino && now.st_dev == scanned->st_dev
+      && timespec_cmp (get_stat_ctime (&now), get_stat_ctime (scanned)) == 0)
+    {
+      *st = *scanned;
+      return 0;
+    }
+  return deref_fstatat (fd, name, st);
+}
+
 /* Dump a single file, recursing on directories.  ST is the file's
    status info, NAME its name relative to the parent directory, and P
    its full name (which may be relative to the working directory).
+   If SCANNED is not null, it is the status of the file found while
+   scanning its parent directory; it is used instead of looking the
+   file up again in full unless the file has changed since.
 
    Return the address of dynamically allocated storage that the caller
    should free, or the null pointer if there is no such storage.  */
@@ -1607,7 +1983,8 @@ restore_parent_fd (struct tar_stat_info const *st)
    exit_status to failure, a clear diagnostic has been issued.  */
 
 static void *
-dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
+dump_file0 (struct tar_stat_info *st, char const *name, char const *p,
+	    struct stat const *scanned)
 {
   union block *header;
   char type;
@@ -1645,9 +2022,11 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
       diag = open_diag;
     }
   else if (f.fd == BADFD
-	   || fstatat (f.fd, f.base, &st->stat, fstatat_flags) < 0)
+	   || (scanned
+	       ? scanned_fstatat (f.fd, f.base, scanned, &st->stat)
+	       : deref_fstatat (f.fd, f.base, &st->stat)) < 0)
     diag = stat_diag;
-  else if (file_dumpable_p (&st->stat))
+  if (!diag && file_dumpable_p (&st->stat))
     {
       fd = subfile_open (parent, name, open_read_flags);
       if (fd < 0)
@@ -1665,6 +2044,7 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
       return NULL;
     }
 
+  stats_count_member ();
   struct stat st1 = st->stat;
   st->archive_file_size = st->stat.st_size;
   st->atime = get_stat_atime (&st->stat);
@@ -1717,9 +2097,7 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
       bool ok;
       struct stat st2;
 
-      xattrs_acls_get (f.fd, f.base, st, !is_dir);
-      xattrs_selinux_get (f.fd, f.base, st, fd);
-      xattrs_xattrs_get (f.fd, f.base, st, fd);
+      get_file_xattrs (f, st, fd, true, !is_dir);
 
       if (is_dir)
 	{
@@ -1751,6 +2129,11 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
 	{
 	  enum dump_status status;
 
+	  /* Files that fit in a record are read in one go, and gain
+	     nothing from reading ahead.  */
+	  if (0 < fd && record_size < st->stat.st_size)
+	    sys_advise_sequential (fd);
+
 	  if (fd && sparse_option && ST_IS_SPARSE (st->stat))
 	    {
 	      status = sparse_dump_file (fd, st);
@@ -1774,6 +2157,8 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
 	      abort ();
 	    }
 
+	  if (0 < fd)
+	    sys_drop_cache (fd, 0, 0);
 	  ok = status == dump_status_ok;
 	}
 
@@ -1865,8 +2250,7 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
 	  < strlen (st->link_name))
 	write_long_link (st);
 
-      xattrs_selinux_get (f.fd, f.base, st, 0);
-      xattrs_xattrs_get (f.fd, f.base, st, 0);
+      get_file_xattrs (f, st, 0, false, false);
 
       block_ordinal = current_block_ordinal ();
       st->stat.st_size = 0;	/* force 0 size on symlink */
@@ -1887,23 +2271,17 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
   else if (S_ISCHR (st->stat.st_mode))
     {
       type = CHRTYPE;
-      xattrs_acls_get (f.fd, f.base, st, true);
-      xattrs_selinux_get (f.fd, f.base, st, 0);
-      xattrs_xattrs_get (f.fd, f.base, st, 0);
+      get_file_xattrs (f, st, 0, true, true);
     }
   else if (S_ISBLK (st->stat.st_mode))
     {
       type = BLKTYPE;
-      xattrs_acls_get (f.fd, f.base, st, true);
-      xattrs_selinux_get (f.fd, f.base, st, 0);
-      xattrs_xattrs_get (f.fd, f.base, st, 0);
+      get_file_xattrs (f, st, 0, true, true);
     }
   else if (S_ISFIFO (st->stat.st_mode))
     {
       type = FIFOTYPE;
-      xattrs_acls_get (f.fd, f.base, st, true);
-      xattrs_selinux_get (f.fd, f.base, st, 0);
-      xattrs_xattrs_get (f.fd, f.base, st, 0);
+      get_file_xattrs (f, st, 0, true, true);
     }
   else if (S_ISSOCK (st->stat.st_mode))
     {
@@ -1942,17 +2320,25 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
 /* Dump a file, recursively.  PARENT describes the file's parent
    directory, NAME is the file's name relative to PARENT, and FULLNAME
    its full name, possibly relative to the working directory.  NAME
-   may contain slashes at the top level of invocation.  */
+   may contain slashes at the top level of invocation.  SCANNED is as
+   for dump_file0.  */
 
-void
-dump_file (struct tar_stat_info *parent, char const *name,
-	   char const *fullname)
+static void
+dump_scanned_file (struct tar_stat_info *parent, char const *name,
+		   char const *fullname, struct stat const *scanned)
 {
   struct tar_stat_info st;
   tar_stat_init (&st);
   st.parent = parent;
-  free (dump_file0 (&st, name, fullname));
+  free (dump_file0 (&st, name, fullname, scanned));
   if (parent && listed_incremental_option)
     update_parent_directory (parent);
   tar_stat_destroy (&st);
 }
+
+void
+dump_file (struct tar_stat_info *parent, char const *name,
+	   char const *fullname)
+{
+  dump_scanned_file (parent, name, fullname, NULL);
+}
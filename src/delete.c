@@ -254,6 +254,7 @@ delete_archive_members (void)
 	  if (current_block == record_end)
 	    flush_archive ();
 
+	  xheader_destroy (&current_stat_info.xhdr);
 	  status = read_header (&current_header, &current_stat_info,
 				read_header_auto);
 
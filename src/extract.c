@@ -423,15 +423,20 @@ check_time (char const *file_name, struct timespec t)
    If FD is nonnegative, it is a file descriptor for the file.
    CURRENT_MODE and CURRENT_MODE_MASK specify information known about
    the file's current mode, using the style of struct delayed_set_stat.
+   OWNER_SET means the file is already owned by ST's uid and gid.
    TYPEFLAG specifies the type of the file.
    If INTERDIR, this is an intermediate directory.
-   ATFLAG specifies the flag to use when statting the file.  */
+   ATFLAG specifies the flag to use when statting the file.
+
+   When FD is nonnegative, every attribute is applied through it, in
+   the order times, owner, mode, extended attributes, ACLs and SELinux
+   context, and attributes already known to be correct are skipped.  */
 
 static void
 set_stat (char const *file_name,
 	  struct tar_stat_info const *st,
 	  int fd, mode_t current_mode, mode_t current_mode_mask,
-	  char typeflag, bool interdir, int atflag)
+	  bool owner_set, char typeflag, bool interdir, int atflag)
 {
   /* Do the utime before the chmod because some versions of utime are
      broken and trash the modes of the file.  */
@@ -463,7 +468,7 @@ set_stat (char const *file_name,
 	utime_error (file_name);
     }
 
-  if (0 < same_owner_option && ! interdir)
+  if (0 < same_owner_option && ! interdir && ! owner_set)
     {
       /* Some systems allow non-root users to give files away.  Once this
 	 done, it is not possible anymore to change file permissions.
@@ -491,9 +496,11 @@ set_stat (char const *file_name,
 
   /* these three calls must be done *after* fd_chown() call because fd_chown
      causes that linux capabilities becomes cleared. */
-  xattrs_xattrs_set (st, file_name, typeflag, true);
-  xattrs_acls_set (st, file_name, typeflag);
-  xattrs_selinux_set (st, file_name, typeflag);
+  struct timespec start = stats_start ();
+  xattrs_xattrs_set (st, file_name, fd, typeflag, true);
+  xattrs_acls_set (st, file_name, fd, typeflag);
+  xattrs_selinux_set (st, file_name, fd, typeflag);
+  stats_stop (STATS_XATTR, start);
 }
 
 /* Find the direct ancestor of FILE_NAME in the delayed_set_stat list.  */
@@ -580,7 +587,8 @@ delay_set_stat (char const *file_name, struct tar_stat_info const *st,
 	  struct stat real_st;
 	  struct fdbase f = fdbase (data->file_name);
 	  if (f.fd == BADFD
-	      || fstatat (f.fd, f.base, &real_st, data->atflag) < 0)
+	      || fstatat_fields (f.fd, f.base, &real_st, data->atflag,
+				 STAT_INO) < 0)
 	    {
 	      stat_error (data->file_name);
 	    }
@@ -598,6 +606,7 @@ delay_set_stat (char const *file_name, struct tar_stat_info const *st,
       delayed_set_stat_head = data;
       data->file_name_len = file_name_len;
       data->file_name = xstrdup (file_name);
+      stats_alloc (STATS_MEM_DELAYED, sizeof *data + file_name_len + 1);
       if (! hash_insert (delayed_set_stat_table, data))
 	xalloc_die ();
       data->metadata_set = false;
@@ -693,7 +702,8 @@ repair_delayed_set_stat (char const *dir,
     {
       struct stat st;
       struct fdbase f = fdbase (data->file_name);
-      if (f.fd == BADFD || fstatat (f.fd, f.base, &st, data->atflag) < 0)
+      if (f.fd == BADFD
+	  || fstatat_fields (f.fd, f.base, &st, data->atflag, STAT_INO) < 0)
 	{
 	  stat_error (data->file_name);
 	  return;
@@ -722,6 +732,7 @@ repair_delayed_set_stat (char const *dir,
 static void
 free_delayed_set_stat (struct delayed_set_stat *data)
 {
+  stats_free (STATS_MEM_DELAYED, sizeof *data + data->file_name_len + 1);
   free (data->file_name);
   xattr_map_free (&data->xattr_map);
   free (data->cntx_name);
@@ -753,6 +764,20 @@ remove_delayed_set_stat (const char *fname)
     }
 }
 
+/* Forget the status of all directories whose status setting was
+   delayed.  Another process sets it.  */
+void
+forget_delayed_set_stat (void)
+{
+  while (delayed_set_stat_head)
+    {
+      struct delayed_set_stat *data = delayed_set_stat_head;
+      delayed_set_stat_head = data->next;
+      hash_remove (delayed_set_stat_table, data);
+      free_delayed_set_stat (data);
+    }
+}
+
 static void
 fixup_delayed_set_stat (char const *src, char const *dst)
 {
@@ -764,6 +789,7 @@ fixup_delayed_set_stat (char const *src, char const *dst)
 	{
 	  free (data->file_name);
 	  data->file_name = xstrdup (dst);
+	  stats_alloc (STATS_MEM_DELAYED, strlen (dst) - data->file_name_len);
 	  data->file_name_len = strlen (dst);
 	  return;
 	}
@@ -932,7 +958,10 @@ file_newer_p (const char *file_name, struct stat const *stp,
 
   if (!stp)
     {
-      if (deref_stat (file_name, &st) < 0)
+      struct fdbase f = fdbase (file_name);
+      if (f.fd == BADFD
+	  || deref_fstatat_fields (f.fd, f.base, &st,
+				   STAT_TYPE | STAT_MTIME) < 0)
 	{
 	  if (errno != ENOENT)
 	    {
@@ -1048,27 +1077,31 @@ maybe_recoverable (char *file_name, bool regular, bool *interdir_made)
 }
 
 /* Restore stat extended attributes (xattr) for FILE_NAME, using information
-   given in *ST.  Restore before extraction because they may affect file layout
-   (e.g. on Lustre distributed parallel filesystem - setting info about how many
-   servers is this file striped over, stripe size, mirror copies, etc.
-   in advance dramatically improves the following  performance of reading and
-   writing a file).  TYPEFLAG specifies the type of the file.  Return a negative
+   given in *ST, if some of them affect file layout (e.g. on Lustre distributed
+   parallel filesystem - setting info about how many servers is this file
+   striped over, stripe size, mirror copies, etc. in advance dramatically
+   improves the following  performance of reading and writing a file).  The
+   file system accepts those only on a file that has not been opened yet, so
+   create FILE_NAME with MODE as an empty node first, and set the attributes
+   by name.  TYPEFLAG specifies the type of the file.  Return a negative
    number (setting errno) on failure, zero if successful but FILE_NAME was not
-   created (e.g., xattrs not available), and a positive number if FILE_NAME was
+   created (e.g., no layout attributes), and a positive number if FILE_NAME was
    created.  */
 static int
-set_xattr (MAYBE_UNUSED char const *file_name,
-	   MAYBE_UNUSED struct tar_stat_info const *st,
-	   MAYBE_UNUSED mode_t mode, MAYBE_UNUSED char typeflag)
+set_layout_xattr (MAYBE_UNUSED char const *file_name,
+		  MAYBE_UNUSED struct tar_stat_info const *st,
+		  MAYBE_UNUSED mode_t mode, MAYBE_UNUSED char typeflag)
 {
 #ifdef HAVE_XATTRS
-  if (xattrs_option && st->xattr_map.xm_size)
+  if (xattrs_option && xattrs_layout_p (st))
     {
       struct fdbase f = fdbase (file_name);
       int r = f.fd == BADFD ? -1 : mknodat (f.fd, f.base, mode | S_IFREG, 0);
       if (r < 0)
 	return r;
-      xattrs_xattrs_set (st, file_name, typeflag, false);
+      struct timespec start = stats_start ();
+      xattrs_xattrs_set (st, file_name, -1, typeflag, false);
+      stats_stop (STATS_XATTR, start);
       return 1;
     }
 #endif
@@ -1076,6 +1109,25 @@ set_xattr (MAYBE_UNUSED char const *file_name,
   return 0;
 }
 
+/* Restore stat extended attributes (xattr) for FILE_NAME, using information
+   given in *ST, before extraction, when set_layout_xattr did not.  FD is the
+   freshly opened, still empty output file.  TYPEFLAG specifies the type of
+   the file.  */
+static void
+set_xattr (MAYBE_UNUSED char const *file_name,
+	   MAYBE_UNUSED struct tar_stat_info const *st,
+	   MAYBE_UNUSED int fd, MAYBE_UNUSED char typeflag)
+{
+#ifdef HAVE_XATTRS
+  if (xattrs_option && st->xattr_map.xm_size)
+    {
+      struct timespec start = stats_start ();
+      xattrs_xattrs_set (st, file_name, fd, typeflag, false);
+      stats_stop (STATS_XATTR, start);
+    }
+#endif
+}
+
 /* Fix the statuses of all directories whose statuses need fixing, and
    which are not ancestors of FILE_NAME.  If METADATA_SET,
    do this for all such directories; otherwise, stop at the
@@ -1110,7 +1162,9 @@ apply_nonancestor_delayed_set_stat (char const *file_name, bool metadata_set)
       if (check_for_renamed_directories)
 	{
 	  struct fdbase f = fdbase (data->file_name);
-	  if (f.fd == BADFD || fstatat (f.fd, f.base, &st, data->atflag) < 0)
+	  if (f.fd == BADFD
+	      || fstatat_fields (f.fd, f.base, &st, data->atflag,
+				 STAT_MODE | STAT_INO) < 0)
 	    {
 	      stat_error (data->file_name);
 	      skip_this_one = 1;
@@ -1145,7 +1199,7 @@ apply_nonancestor_delayed_set_stat (char const *file_name, bool metadata_set)
 	  sb.acls_d_len = data->acls_d_len;
 	  sb.xattr_map = data->xattr_map;
 	  set_stat (data->file_name, &sb,
-		    -1, current_mode, current_mode_mask,
+		    -1, current_mode, current_mode_mask, false,
 		    DIRTYPE, data->interdir, data->atflag);
 	}
 
@@ -1251,7 +1305,8 @@ extract_dir (char *file_name, char UNNAMED (typeflag))
 	      || old_files_option == OVERWRITE_OLD_FILES)
 	    {
 	      struct stat st;
-	      if (fstatat (f.fd, f.base, &st, fstatat_flags) == 0)
+	      if (deref_fstatat_fields (f.fd, f.base, &st,
+					STAT_MODE | STAT_INO) == 0)
 		{
 		  current_mode = st.st_mode;
 		  current_mode_mask = all_mode_bits;
@@ -1271,7 +1326,8 @@ extract_dir (char *file_name, char UNNAMED (typeflag))
 
 		  struct stat dirst;
 		  if (S_ISLNK (st.st_mode) && keep_directory_symlink_option
-		      && fstatat (f.fd, f.base, &dirst, 0) == 0
+		      && fstatat_fields (f.fd, f.base, &dirst, 0,
+					 STAT_TYPE) == 0
 		      && S_ISDIR (dirst.st_mode))
 		    return true;
 		}
@@ -1317,10 +1373,16 @@ extract_dir (char *file_name, char UNNAMED (typeflag))
 
 
 
+/* Open FILE_NAME for writing, creating it with MODE if need be,
+   unless FILE_CREATED says it has just been created.  Store what is
+   known about the mode of the resulting file into *CURRENT_MODE and
+   *CURRENT_MODE_MASK, in the style of struct delayed_set_stat, and set
+   *OWNER_SET if the file is already owned by the member's uid and
+   gid.  */
 static int
 open_output_file (char const *file_name, char typeflag, mode_t mode,
                   int file_created, mode_t *current_mode,
-                  mode_t *current_mode_mask)
+		  mode_t *current_mode_mask, bool *owner_set)
 {
   int fd;
   bool overwriting_old_files = old_files_option == OVERWRITE_OLD_FILES;
@@ -1362,8 +1424,11 @@ open_output_file (char const *file_name, char typeflag, mode_t mode,
     {
       if (openflag & O_EXCL)
 	{
+	  /* MODE has no set-user-ID, set-group-ID or sticky bits, so
+	     the file was created without them.  */
 	  *current_mode = mode & ~ current_umask;
-	  *current_mode_mask = MODE_RWX;
+	  *current_mode_mask = MODE_ALL;
+	  *owner_set = false;
 	}
       else
 	{
@@ -1383,6 +1448,8 @@ open_output_file (char const *file_name, char typeflag, mode_t mode,
 	    }
 	  *current_mode = st.st_mode;
 	  *current_mode_mask = all_mode_bits;
+	  *owner_set = (st.st_uid == current_stat_info.stat.st_uid
+			&& st.st_gid == current_stat_info.stat.st_gid);
 	}
     }
 
@@ -1401,6 +1468,7 @@ extract_file (char *file_name, char typeflag)
 		 & ~ (0 < same_owner_option ? S_IRWXG | S_IRWXO : 0));
   mode_t current_mode = 0;
   mode_t current_mode_mask = 0;
+  bool owner_set = false;
 
   if (to_stdout_option)
     fd = STDOUT_FILENO;
@@ -1413,16 +1481,18 @@ extract_file (char *file_name, char typeflag)
   else
     {
       int file_created;
-      /* Either we pre-create the file in set_xattr(), or we just directly open
-         the file in open_output_file() with O_CREAT.  If pre-creating, we need
-         to use S_IWUSR so we can open the file O_WRONLY in open_output_file().
-         The additional mode bit is cleared later by set_stat()->set_mode().  */
-      while (((file_created = set_xattr (file_name, &current_stat_info,
-					 mode | S_IWUSR, typeflag))
+      /* Either we pre-create the file in set_layout_xattr(), or we just
+         directly open the file in open_output_file() with O_CREAT.  If
+         pre-creating, we need to use S_IWUSR so we can open the file
+         O_WRONLY in open_output_file().  The additional mode bit is
+         cleared later by set_stat().  */
+      while (((file_created
+	       = set_layout_xattr (file_name, &current_stat_info,
+				   mode | S_IWUSR, typeflag))
 	      < 0)
 	     || ((fd = open_output_file (file_name, typeflag, mode,
 					 file_created, &current_mode,
-					 &current_mode_mask))
+					 &current_mode_mask, &owner_set))
 		 < 0))
 	{
 	  enum recover recover
@@ -1435,6 +1505,9 @@ extract_file (char *file_name, char typeflag)
 	      return false;
 	    }
 	}
+
+      if (!file_created)
+	set_xattr (file_name, &current_stat_info, fd, typeflag);
     }
 
   mv_begin_read (&current_stat_info);
@@ -1486,10 +1559,13 @@ extract_file (char *file_name, char typeflag)
     return true;
 
   if (! to_command_option)
-    set_stat (file_name, &current_stat_info, fd,
-	      current_mode, current_mode_mask, typeflag, false,
-	      (old_files_option == OVERWRITE_OLD_FILES
-	       ? 0 : AT_SYMLINK_NOFOLLOW));
+    {
+      set_stat (file_name, &current_stat_info, fd,
+		current_mode, current_mode_mask, owner_set, typeflag, false,
+		(old_files_option == OVERWRITE_OLD_FILES
+		 ? 0 : AT_SYMLINK_NOFOLLOW));
+      sys_drop_written_cache (fd);
+    }
 
   status = close (fd);
   if (status < 0)
@@ -1518,7 +1594,9 @@ find_delayed_link_source (char const *name)
     return false;
 
   struct fdbase f = fdbase (name);
-  if (f.fd == BADFD || fstatat (f.fd, f.base, &st, AT_SYMLINK_NOFOLLOW) < 0)
+  if (f.fd == BADFD
+      || fstatat_fields (f.fd, f.base, &st, AT_SYMLINK_NOFOLLOW,
+			 STAT_INO) < 0)
     {
       if (errno != ENOENT)
 	stat_error (name);
@@ -1575,7 +1653,7 @@ create_placeholder_file (char *file_name, bool is_symlink, bool *interdir_made)
 	}
     }
 
-  if (fstat (fd, &st) < 0)
+  if (fstat_fields (fd, &st, STAT_INO) < 0)
     {
       stat_error (file_name);
       close (fd);
@@ -1585,9 +1663,9 @@ create_placeholder_file (char *file_name, bool is_symlink, bool *interdir_made)
   else
     {
       struct delayed_set_stat *h;
-      struct delayed_link *p =
-	xmalloc (FLEXNSIZEOF (struct delayed_link, target,
-			      strlen (current_stat_info.link_name) + 1));
+      idx_t size = FLEXNSIZEOF (struct delayed_link, target,
+				strlen (current_stat_info.link_name) + 1);
+      struct delayed_link *p = xmalloc (size);
       p->next = NULL;
       p->st_dev = st.st_dev;
       p->st_ino = st.st_ino;
@@ -1604,8 +1682,10 @@ create_placeholder_file (char *file_name, bool is_symlink, bool *interdir_made)
 	  p->mtime = current_stat_info.mtime;
 	}
       p->change_dir = chdir_current;
-      p->sources = xmalloc (FLEXNSIZEOF (struct string_list, string,
-					 strlen (file_name) + 1));
+      idx_t sources_size = FLEXNSIZEOF (struct string_list, string,
+					strlen (file_name) + 1);
+      p->sources = xmalloc (sources_size);
+      stats_alloc (STATS_MEM_DELAYED, size + sources_size);
       p->sources->next = NULL;
       strcpy (p->sources->string, file_name);
       p->cntx_name = NULL;
@@ -1667,7 +1747,8 @@ extract_link (char *file_name, char UNNAMED (typeflag))
       if (status == 0)
 	{
 	  if (delayed_link_table
-	      && fstatat (f1.fd, f1.base, &st1, AT_SYMLINK_NOFOLLOW) == 0)
+	      && fstatat_fields (f1.fd, f1.base, &st1, AT_SYMLINK_NOFOLLOW,
+				 STAT_INO) == 0)
 	    {
 	      struct delayed_link dl1;
 	      dl1.st_ino = st1.st_ino;
@@ -1676,9 +1757,10 @@ extract_link (char *file_name, char UNNAMED (typeflag))
 	      if (ds && ds->change_dir == chdir_current
 		  && BIRTHTIME_EQ (ds->birthtime, get_stat_birthtime (&st1)))
 		{
-		  struct string_list *p
-		    = xmalloc (FLEXNSIZEOF (struct string_list,
-					    string, strlen (file_name) + 1));
+		  idx_t size = FLEXNSIZEOF (struct string_list,
+					    string, strlen (file_name) + 1);
+		  struct string_list *p = xmalloc (size);
+		  stats_alloc (STATS_MEM_DELAYED, size);
 		  strcpy (p->string, file_name);
 		  p->next = ds->sources;
 		  ds->sources = p;
@@ -1691,8 +1773,10 @@ extract_link (char *file_name, char UNNAMED (typeflag))
       int e = errno;
       if ((e == EEXIST && streq (link_name, file_name))
 	  || (f.fd != BADFD && f1.fd != BADFD
-	      && fstatat (f1.fd, f1.base, &st1, AT_SYMLINK_NOFOLLOW) == 0
-	      && fstatat (f.fd, f.base, &st, AT_SYMLINK_NOFOLLOW) == 0
+	      && fstatat_fields (f1.fd, f1.base, &st1, AT_SYMLINK_NOFOLLOW,
+				 STAT_INO) == 0
+	      && fstatat_fields (f.fd, f.base, &st, AT_SYMLINK_NOFOLLOW,
+				 STAT_INO) == 0
 	      && psame_inode (&st1, &st)))
 	return true;
       errno = e;
@@ -1749,7 +1833,7 @@ extract_symlink (char *file_name, char typeflag)
 	return false;
       }
 
-  set_stat (file_name, &current_stat_info, -1, 0, 0,
+  set_stat (file_name, &current_stat_info, -1, 0, 0, false,
 	    SYMTYPE, false, AT_SYMLINK_NOFOLLOW);
   return true;
 }
@@ -1780,7 +1864,7 @@ extract_node (char *file_name, char typeflag)
       }
 
   set_stat (file_name, &current_stat_info, -1,
-	    mode & ~ current_umask, MODE_RWX,
+	    mode & ~ current_umask, MODE_RWX, false,
 	    typeflag, false, AT_SYMLINK_NOFOLLOW);
   return true;
 }
@@ -1812,7 +1896,7 @@ extract_fifo (char *file_name, char typeflag)
       }
 
   set_stat (file_name, &current_stat_info, -1,
-	    mode & ~ current_umask, MODE_RWX,
+	    mode & ~ current_umask, MODE_RWX, false,
 	    typeflag, false, AT_SYMLINK_NOFOLLOW);
   return true;
 }
@@ -1949,6 +2033,10 @@ extract_archive (void)
   set_next_block_after (current_header);
 
   if (!current_stat_info.file_name[0]
+      || restore_plan_skip (current_stat_info.file_name,
+			    (current_header->header.typeflag == DIRTYPE
+			     || current_header->header.typeflag
+				== GNUTYPE_DUMPDIR))
       || (interactive_option
 	  && !confirm ("extract", current_stat_info.file_name)))
     {
@@ -2041,7 +2129,9 @@ apply_delayed_link (struct delayed_link *ds)
 	 don't create a link, as the placeholder was probably
 	 removed by a later extraction.  */
       struct fdbase f = fdbase (source);
-      if (f.fd != BADFD && fstatat (f.fd, f.base, &st, AT_SYMLINK_NOFOLLOW) == 0
+      if (f.fd != BADFD
+	  && fstatat_fields (f.fd, f.base, &st, AT_SYMLINK_NOFOLLOW,
+			     STAT_INO) == 0
 	  && SAME_INODE (st, *ds)
 	  && BIRTHTIME_EQ (get_stat_birthtime (&st), ds->birthtime))
 	{
@@ -2078,7 +2168,7 @@ apply_delayed_link (struct delayed_link *ds)
 	      st1.acls_d_ptr = ds->acls_d_ptr;
 	      st1.acls_d_len = ds->acls_d_len;
 	      st1.xattr_map = ds->xattr_map;
-	      set_stat (source, &st1, -1, 0, 0, SYMTYPE,
+	      set_stat (source, &st1, -1, 0, 0, false, SYMTYPE,
 			false, AT_SYMLINK_NOFOLLOW);
 	      valid_source = source;
 	    }
@@ -2134,6 +2224,8 @@ extract_finish (void)
      of delayed links.  */
   apply_nonancestor_delayed_set_stat ("", true);
 
+  sys_drop_written_cache_finish ();
+
   /* This table should be empty after apply_nonancestor_delayed_set_stat.  */
   if (false && delayed_set_stat_table)
     {
@@ -67,6 +67,8 @@ struct dumpdir                 /* Dump directory listing */
   idx_t total;		       /* Total number of elements */
   idx_t elc;		       /* Number of D/N/Y elements. */
   char **elv;                  /* Array of D/N/Y elements */
+  struct stat **stv;           /* Status of the elements of elv found by
+				  scan_directory, or NULL */
   char contents[FLEXIBLE_ARRAY_MEMBER]; /* Actual contents */
 };
 
@@ -87,7 +89,11 @@ struct directory
     const char *tagfile;        /* Tag file, if the directory falls under
 				   exclusion_tag_under */
     char *caname;               /* canonical name */
-    char *name;	     	        /* file name of directory */
+    char *name;	     	        /* file name of directory; use
+				   directory_name to read it */
+    idx_t renamed;		/* Number of dir_renames applied to name */
+    idx_t ordinal;		/* Index in snapshot_dirs, or -1 */
+    uintmax_t record_hash;	/* Hash of its record in the snapshot file */
   };
 
 static bool
@@ -130,6 +136,15 @@ dir_clear_flag (struct directory *d, int f)
   d->flags &= ~f;
 }
 
+/* Return the number of bytes allocated for DUMP, whose contents take
+   CTSIZE bytes.  */
+static idx_t
+dumpdir_bytes (struct dumpdir const *dump, idx_t ctsize)
+{
+  return (FLEXNSIZEOF (struct dumpdir, contents, ctsize)
+	  + (dump->elc + 1) * sizeof (dump->elv[0]));
+}
+
 static struct dumpdir *
 dumpdir_create0 (const char *contents, const char *cmask)
 {
@@ -150,6 +165,8 @@ dumpdir_create0 (const char *contents, const char *cmask)
   dump->total = total;
   dump->elc = i;
   dump->elv = xcalloc (i + 1, sizeof (dump->elv[0]));
+  dump->stv = NULL;
+  stats_alloc (STATS_MEM_DIRECTORIES, dumpdir_bytes (dump, ctsize));
 
   for (i = 0, p = dump->contents; *p; p += strlen (p) + 1)
     {
@@ -166,13 +183,52 @@ dumpdir_create (const char *contents)
   return dumpdir_create0 (contents, "YND");
 }
 
+/* At most this many statuses found by scan_directory are kept until
+   their files are dumped, whatever --memory-limit says: a level 0 dump
+   would otherwise keep one for every file of the tree.  */
+enum { KEPT_STATS_MAX = 64 * 1024 };
+
+/* Number of statuses kept by dumpdir_keep_stat and not yet taken.  */
+static idx_t kept_stats;
+
 static void
 dumpdir_free (struct dumpdir *dump)
 {
+  stats_free (STATS_MEM_DIRECTORIES,
+	      dumpdir_bytes (dump, dumpdir_size (dump->contents)));
+  if (dump->stv)
+    {
+      for (idx_t i = 0; i < dump->elc; i++)
+	if (dump->stv[i])
+	  {
+	    kept_stats--;
+	    stats_free (STATS_MEM_DIRECTORIES, sizeof *dump->stv[i]);
+	    free (dump->stv[i]);
+	  }
+      stats_free (STATS_MEM_DIRECTORIES, dump->elc * sizeof dump->stv[0]);
+      free (dump->stv);
+    }
   free (dump->elv);
   free (dump);
 }
 
+/* Remember ST as the status of the Ith element of DUMP, so that the
+   file need not be looked up in full again when it is dumped.  */
+static void
+dumpdir_keep_stat (struct dumpdir *dump, idx_t i, struct stat const *st)
+{
+  if (KEPT_STATS_MAX <= kept_stats || memory_limit_reached ())
+    return;
+  if (!dump->stv)
+    {
+      dump->stv = xicalloc (dump->elc, sizeof dump->stv[0]);
+      stats_alloc (STATS_MEM_DIRECTORIES, dump->elc * sizeof dump->stv[0]);
+    }
+  dump->stv[i] = xmemdup (st, sizeof *st);
+  kept_stats++;
+  stats_alloc (STATS_MEM_DIRECTORIES, sizeof *st);
+}
+
 static int
 compare_dirnames (const void *first, const void *second)
 {
@@ -255,6 +311,43 @@ static struct directory *dirhead, *dirtail;
 static Hash_table *directory_table;
 static Hash_table *directory_meta_table;
 
+/* A rename of the directory FROM to TO, found by procdir.  The names
+   of all directories below FROM, as known at the time of the rename,
+   must be changed to begin with TO instead.  Rather than changing
+   them all at once, which would take time proportional to the number
+   of directories for every rename, the renames are logged in
+   dir_renames and each name is brought up to date when it is next
+   needed, by directory_name.  */
+struct dir_rename
+{
+  char *from;
+  idx_t from_len;
+  char *to;
+  idx_t to_len;
+};
+
+static struct dir_rename *dir_renames;
+static idx_t dir_renames_count;
+static idx_t dir_renames_alloc;
+
+/* The indexes in dir_renames of the renames from FROM, in increasing
+   order.  These are the entries of dir_rename_table, keyed by FROM
+   and FROM_LEN.  */
+struct dir_rename_source
+{
+  char const *from;
+  idx_t from_len;
+  idx_t *index;
+  idx_t count;
+  idx_t alloc;
+};
+
+static Hash_table *dir_rename_table;
+
+/* With --changed-files, the canonical names of the files listed as
+   changed since the last dump and of their parent directories.  */
+static Hash_table *changed_files_table;
+
 static bool
 nfs_file_stat (struct stat const *st)
 {
@@ -299,6 +392,41 @@ compare_directory_meta (void const *entry1, void const *entry2)
   return PSAME_INODE (directory1, directory2);
 }
 
+static size_t
+hash_dir_rename_source (void const *entry, size_t n_buckets)
+{
+  struct dir_rename_source const *source = entry;
+  size_t h = 0;
+  for (idx_t i = 0; i < source->from_len; i++)
+    h = h * 31 + (unsigned char) source->from[i];
+  return h % n_buckets;
+}
+
+static bool
+compare_dir_rename_sources (void const *entry1, void const *entry2)
+{
+  struct dir_rename_source const *source1 = entry1;
+  struct dir_rename_source const *source2 = entry2;
+  return (source1->from_len == source2->from_len
+	  && memeq (source1->from, source2->from, source1->from_len));
+}
+
+static void
+free_dir_rename_source (void *entry)
+{
+  struct dir_rename_source *source = entry;
+  free (source->index);
+  free (source);
+}
+
+/* Return the number of bytes allocated for DIR and its names.  */
+static idx_t
+directory_bytes (struct directory const *dir)
+{
+  return (sizeof *dir + strlen (dir->name) + 1
+	  + (dir->caname ? strlen (dir->caname) + 1 : 0));
+}
+
 /* Make a directory entry for given relative NAME and canonical name CANAME.
    The latter is "stolen", i.e. the returned directory contains pointer to
    it. */
@@ -313,12 +441,16 @@ make_directory (const char *name, char *caname)
   memcpy (directory->name, name, namelen);
   directory->name[namelen] = 0;
   directory->caname = caname;
+  directory->renamed = dir_renames_count;
+  directory->ordinal = -1;
+  stats_alloc (STATS_MEM_DIRECTORIES, directory_bytes (directory));
   return directory;
 }
 
 static void
 free_directory (struct directory *dir)
 {
+  stats_free (STATS_MEM_DIRECTORIES, directory_bytes (dir));
   free (dir->caname);
   free (dir->name);
   free (dir);
@@ -338,15 +470,200 @@ attach_directory (const char *name)
 }
 
 
+/* If DIR's name is below the directory PREF, replace the PREF_LEN
+   bytes of PREF at its start with the REPL_LEN bytes of REPL.  */
+static void
+dir_replace_prefix (struct directory *dir,
+		    char const *pref, idx_t pref_len,
+		    char const *repl, idx_t repl_len)
+{
+  idx_t len = strlen (dir->name);
+  replace_prefix (&dir->name, pref, pref_len, repl, repl_len);
+  idx_t newlen = strlen (dir->name);
+  if (len < newlen)
+    stats_alloc (STATS_MEM_DIRECTORIES, newlen - len);
+  else
+    stats_free (STATS_MEM_DIRECTORIES, len - newlen);
+}
+
+static size_t
+hash_changed_file (void const *entry, size_t n_buckets)
+{
+  return hash_string (entry, n_buckets);
+}
+
+static bool
+compare_changed_files (void const *entry1, void const *entry2)
+{
+  return streq (entry1, entry2);
+}
+
+/* Add NAME, which is "stolen", to changed_files_table.  */
+static void
+note_changed_file (char *name)
+{
+  void const *found;
+  int r = hash_insert_if_absent (changed_files_table, name, &found);
+  if (r < 0)
+    xalloc_die ();
+  if (r == 0)
+    free (name);
+  else
+    stats_alloc (STATS_MEM_DIRECTORIES, strlen (name) + 1);
+}
+
+/* Read the file named by changed_files_option, which lists the files
+   changed since the last dump, one per line.  Relative names are
+   relative to the directory with index CDIDX.  Every directory above
+   a listed file is noted as changed too, so that a new directory on
+   the way to it is found even if it is not listed itself.  */
+void
+read_changed_files (idx_t cdidx)
+{
+  FILE *fp = fopen (changed_files_option, "r");
+  if (!fp)
+    open_fatal (changed_files_option);
+
+  changed_files_table = hash_initialize (0, NULL, hash_changed_file,
+					 compare_changed_files, free);
+  if (!changed_files_table)
+    xalloc_die ();
+
+  char *buf = NULL;
+  size_t bufsize = 0;
+  ptrdiff_t len;
+  while (0 < (len = getline (&buf, &bufsize, fp)))
+    {
+      if (buf[len - 1] == '\n')
+	buf[--len] = '\0';
+      if (len == 0)
+	continue;
+      char *name = normalize_filename (cdidx, buf);
+      if (ISSLASH (name[0]))
+	note_changed_file (xstrdup ("/"));
+      for (idx_t i = 1; name[i]; i++)
+	if (ISSLASH (name[i]) && !ISSLASH (name[i - 1]))
+	  note_changed_file (ximemdup0 (name, i));
+      note_changed_file (name);
+    }
+  if (ferror (fp))
+    read_fatal (changed_files_option);
+  fclose (fp);
+  free (buf);
+}
+
+/* Return the name of DIR, after applying to it the renames logged
+   since it was last brought up to date.  */
+static char const *
+directory_name (struct directory *dir)
+{
+  while (dir->renamed < dir_renames_count)
+    {
+      /* Find the earliest pending rename of a directory above DIR.
+	 Renames of other directories would leave the name alone.  */
+      idx_t next = dir_renames_count;
+      char const *name = dir->name;
+      for (idx_t i = 0; name[i]; i++)
+	if (ISSLASH (name[i]))
+	  {
+	    struct dir_rename_source key, *source;
+	    key.from = name;
+	    key.from_len = i;
+	    source = hash_lookup (dir_rename_table, &key);
+	    if (source && dir->renamed <= source->index[source->count - 1])
+	      {
+		idx_t lo = 0, hi = source->count - 1;
+		while (lo < hi)
+		  {
+		    idx_t mid = lo + (hi - lo) / 2;
+		    if (source->index[mid] < dir->renamed)
+		      lo = mid + 1;
+		    else
+		      hi = mid;
+		  }
+		if (source->index[lo] < next)
+		  next = source->index[lo];
+	      }
+	  }
+
+      if (next == dir_renames_count)
+	dir->renamed = next;
+      else
+	{
+	  struct dir_rename const *r = &dir_renames[next];
+	  dir_replace_prefix (dir, r->from, r->from_len, r->to, r->to_len);
+	  dir->renamed = next + 1;
+	}
+    }
+  return dir->name;
+}
+
+/* Log that the directory PREF was renamed to REPL, so that the names
+   of the directories now below it will begin with REPL.  */
 static void
 dirlist_replace_prefix (const char *pref, const char *repl)
 {
-  idx_t pref_len = strlen (pref);
-  idx_t repl_len = strlen (repl);
-  for (struct directory *dp = dirhead; dp; dp = dp->next)
-    replace_prefix (&dp->name, pref, pref_len, repl, repl_len);
+  if (dir_renames_count == dir_renames_alloc)
+    dir_renames = xpalloc (dir_renames, &dir_renames_alloc, 1, -1,
+			   sizeof *dir_renames);
+  struct dir_rename *r = &dir_renames[dir_renames_count];
+  r->from_len = strlen (pref);
+  r->from = xmemdup (pref, r->from_len + 1);
+  r->to_len = strlen (repl);
+  r->to = xmemdup (repl, r->to_len + 1);
+  stats_alloc (STATS_MEM_DIRECTORIES,
+	       sizeof *r + r->from_len + r->to_len + 2);
+
+  if (! (dir_rename_table
+	 || (dir_rename_table = hash_initialize (0, NULL,
+						 hash_dir_rename_source,
+						 compare_dir_rename_sources,
+						 free_dir_rename_source))))
+    xalloc_die ();
+  struct dir_rename_source key, *source;
+  key.from = r->from;
+  key.from_len = r->from_len;
+  source = hash_lookup (dir_rename_table, &key);
+  if (!source)
+    {
+      source = xmalloc (sizeof *source);
+      source->from = r->from;
+      source->from_len = r->from_len;
+      source->index = NULL;
+      source->count = source->alloc = 0;
+      if (!hash_insert (dir_rename_table, source))
+	xalloc_die ();
+    }
+  if (source->count == source->alloc)
+    source->index = xpalloc (source->index, &source->alloc, 1, -1,
+			     sizeof *source->index);
+  source->index[source->count++] = dir_renames_count++;
+}
+
+/* Forget the logged renames.  */
+static void
+clear_dir_renames (void)
+{
+  if (dir_rename_table)
+    hash_clear (dir_rename_table);
+  for (idx_t i = 0; i < dir_renames_count; i++)
+    {
+      struct dir_rename *r = &dir_renames[i];
+      stats_free (STATS_MEM_DIRECTORIES,
+		  sizeof *r + r->from_len + r->to_len + 2);
+      free (r->from);
+      free (r->to);
+    }
+  dir_renames_count = 0;
 }
 
+/* The directories of the snapshot file, in the order of their records.
+   A delta of a version 3 snapshot removes a directory by its index in
+   this array; the entries of removed directories are null.  */
+static struct directory **snapshot_dirs;
+static idx_t snapshot_dirs_count;
+static idx_t snapshot_dirs_alloc;
+
 void
 clear_directory_table (void)
 {
@@ -363,6 +680,12 @@ clear_directory_table (void)
       dp = next;
     }
   dirhead = dirtail = NULL;
+  clear_dir_renames ();
+  stats_free (STATS_MEM_DIRECTORIES,
+	      snapshot_dirs_alloc * sizeof *snapshot_dirs);
+  free (snapshot_dirs);
+  snapshot_dirs = NULL;
+  snapshot_dirs_count = snapshot_dirs_alloc = 0;
 }
 
 /* Create and link a new directory entry for directory NAME, having a
@@ -444,8 +767,9 @@ rebase_directory (struct directory *dir,
 		  const char *old_prefix, idx_t old_prefix_len,
 		  const char *new_prefix, idx_t new_prefix_len)
 {
-  replace_prefix (&dir->name, old_prefix, old_prefix_len,
-		  new_prefix, new_prefix_len);
+  directory_name (dir);
+  dir_replace_prefix (dir, old_prefix, old_prefix_len,
+		      new_prefix, new_prefix_len);
 }
 
 /* Return a directory entry for a given combination of device and inode
@@ -475,7 +799,7 @@ update_parent_directory (struct tar_stat_info *parent)
     {
       struct stat st;
       if (fstat (parent->fd, &st) < 0)
-	stat_diag (directory->name);
+	stat_diag (directory_name (directory));
       else
 	directory->mtime = get_stat_mtime (&st);
     }
@@ -508,7 +832,10 @@ procdir (const char *name_buffer, struct tar_stat_info *st,
 	{
 	  if (flag & PD_FORCE_INIT)
 	    {
+	      stats_free (STATS_MEM_DIRECTORIES, strlen (directory->name));
 	      assign_string (&directory->name, name_buffer);
+	      stats_alloc (STATS_MEM_DIRECTORIES, strlen (directory->name));
+	      directory->renamed = dir_renames_count;
 	    }
 	  else
 	    {
@@ -517,7 +844,7 @@ procdir (const char *name_buffer, struct tar_stat_info *st,
 	    }
 	}
 
-      if (!streq (directory->name, name_buffer))
+      if (!streq (directory_name (directory), name_buffer))
 	{
 	  *entry = 'N';
 	  return directory;
@@ -539,16 +866,16 @@ procdir (const char *name_buffer, struct tar_stat_info *st,
 						     stat_data->st_ino);
 	  if (d)
 	    {
-	      if (!streq (d->name, name_buffer))
+	      if (!streq (directory_name (d), name_buffer))
 		{
 		  warnopt (WARN_RENAME_DIRECTORY, 0,
 			   _("%s: Directory has been renamed from %s"),
 			   quotearg_colon (name_buffer),
-			   quote_n (1, d->name));
+			   quote_n (1, directory_name (d)));
 		  directory->orig = d;
 		  dir_set_flag (directory, DIRF_RENAMED);
 		  dir_clear_flag (d, DIRF_RENAMED);
-		  dirlist_replace_prefix (d->name, name_buffer);
+		  dirlist_replace_prefix (directory_name (d), name_buffer);
 		}
 	      directory->children = CHANGED_CHILDREN;
 	    }
@@ -582,16 +909,16 @@ procdir (const char *name_buffer, struct tar_stat_info *st,
 
       if (d)
 	{
-	  if (!streq (d->name, name_buffer))
+	  if (!streq (directory_name (d), name_buffer))
 	    {
 	      warnopt (WARN_RENAME_DIRECTORY, 0,
 		       _("%s: Directory has been renamed from %s"),
 		       quotearg_colon (name_buffer),
-		       quote_n (1, d->name));
+		       quote_n (1, directory_name (d)));
 	      directory->orig = d;
 	      dir_set_flag (directory, DIRF_RENAMED);
 	      dir_clear_flag (d, DIRF_RENAMED);
-	      dirlist_replace_prefix (d->name, name_buffer);
+	      dirlist_replace_prefix (directory_name (d), name_buffer);
 	    }
 	  directory->children = CHANGED_CHILDREN;
 	}
@@ -618,7 +945,7 @@ procdir (const char *name_buffer, struct tar_stat_info *st,
     {
       warnopt (WARN_XDEV, 0,
 	       _("%s: directory is on a different filesystem; not dumped"),
-	       quotearg_colon (directory->name));
+	       quotearg_colon (directory_name (directory)));
       directory->children = NO_CHILDREN;
       /* If there is any dumpdir info in that directory, remove it */
       if (directory->dump)
@@ -755,6 +1082,44 @@ makedumpdir (struct directory *directory, const char *dir)
   free (array);
 }
 
+/* Make the dumpdir of DIRECTORY from the one it had in the last dump,
+   without reading the directory: entries that were subdirectories
+   are to be scanned again, and the others are unchanged.  */
+static void
+carrydumpdir (struct directory *directory)
+{
+  struct dumpdir *dump = directory->dump;
+  char *new_dump = xmalloc (dumpdir_size (dump->contents));
+  char *p = new_dump;
+
+  for (idx_t i = 0; i < dump->elc; i++)
+    {
+      *p++ = dump->elv[i][-1] == 'D' ? ' ' : 'N';
+      p = stpcpy (p, dump->elv[i]) + 1;
+    }
+  *p = 0;
+  directory->idump = directory->dump;
+  directory->dump = dumpdir_create0 (new_dump, NULL);
+  free (new_dump);
+}
+
+/* Return true if --changed-files lists no changes in the directory
+   DIR, which was in the last dump, so that its entries can be taken
+   from the snapshot instead of being read again.  */
+static bool
+directory_unchanged_p (char const *dir)
+{
+  if (!changed_files_table)
+    return false;
+  char *caname = normalize_filename (chdir_current, dir);
+  bool listed = hash_lookup (changed_files_table, caname);
+  free (caname);
+  if (listed)
+    return false;
+  struct directory *directory = find_directory (dir);
+  return directory && directory->dump;
+}
+
 /* Create a dumpdir containing only one entry: that for the
    tagfile. */
 static void
@@ -776,15 +1141,17 @@ struct directory *
 scan_directory (struct tar_stat_info *st)
 {
   char const *dir = st->orig_file_name;
-  char *dirp = get_directory_entries (st);
+  bool unchanged = directory_unchanged_p (dir);
+  char *dirp = unchanged ? NULL : get_directory_entries (st);
   dev_t device = st->stat.st_dev;
   bool cmdline = ! st->parent;
+  bool carry = false;
   namebuf_t nbuf;
   char *tmp;
   struct directory *directory;
   char ch;
 
-  if (! dirp)
+  if (! dirp && ! unchanged)
     savedir_error (dir);
 
   info_attach_exclist (st);
@@ -798,24 +1165,43 @@ scan_directory (struct tar_stat_info *st)
 
   free (tmp);
 
+  /* Carry the entries of an unchanged directory forward, unless it
+     turns out to be a different directory than in the last dump.  */
+  if (unchanged)
+    {
+      if (directory->children == CHANGED_CHILDREN && ! directory->orig
+	  && directory->dump && ! directory->tagfile)
+	carry = true;
+      else if (! (dirp = get_directory_entries (st)))
+	savedir_error (dir);
+    }
+
   nbuf = namebuf_create (dir);
 
-  if (dirp)
+  if (dirp || carry)
     {
       if (directory->children != NO_CHILDREN)
 	{
 	  char *entry;	/* directory entry being scanned */
+	  idx_t i;	/* its index in directory->dump->elv */
 	  struct dumpdir_iter *itr;
 
-	  makedumpdir (directory, dirp);
+	  if (carry)
+	    carrydumpdir (directory);
+	  else
+	    makedumpdir (directory, dirp);
 
-	  for (entry = dumpdir_first (directory->dump, true, &itr);
+	  /* The new dumpdir has no mask, so its elv lists all the
+	     entries in order.  */
+	  for (entry = dumpdir_first (directory->dump, true, &itr), i = 0;
 	       entry;
-	       entry = dumpdir_next (itr))
+	       entry = dumpdir_next (itr), i++)
 	    {
 	      char *full_name = namebuf_name (nbuf, entry + 1);
 
-	      if (*entry == 'I') /* Ignored entry */
+	      if (*entry == 'N')
+		/* Unchanged entry, see carrydumpdir */;
+	      else if (*entry == 'I') /* Ignored entry */
 		*entry = 'N';
 	      else if (excluded_name (full_name, st))
 		*entry = 'N';
@@ -826,14 +1212,21 @@ scan_directory (struct tar_stat_info *st)
 		  struct tar_stat_info stsub;
 		  tar_stat_init (&stsub);
 
+		  /* New entries are dumped with the status found here.
+		     For the others only the type and times are needed
+		     to tell whether they changed; directories get their
+		     full status from fstat below.  */
+		  bool is_new = *entry == 'Y';
+		  int fields = (is_new ? STAT_ALL
+				: STAT_TYPE | STAT_MTIME | STAT_CTIME);
+
 		  if (fd < 0)
 		    {
 		      errno = - fd;
 		      diag = open_diag;
 		    }
-		  else if (fstatat (fd, entry + 1, &stsub.stat,
-				    fstatat_flags)
-			   < 0)
+		  else if (deref_fstatat_fields (fd, entry + 1, &stsub.stat,
+						 fields) < 0)
 		    diag = stat_diag;
 		  else if (S_ISDIR (stsub.stat.st_mode))
 		    {
@@ -884,6 +1277,9 @@ scan_directory (struct tar_stat_info *st)
 		  else
 		    *entry = 'Y';
 
+		  if (is_new && *entry == 'Y')
+		    dumpdir_keep_stat (directory->dump, i, &stsub.stat);
+
 		  tar_stat_destroy (&stsub);
 		}
 	    }
@@ -909,6 +1305,30 @@ directory_contents (struct directory *dir)
   return dir->dump ? dir->dump->contents : NULL;
 }
 
+/* If scan_directory recorded the status of the entry NAME of DIR,
+   copy it to ST, forget it and return true.  Otherwise return false.  */
+bool
+directory_entry_stat (struct directory *dir, char const *name,
+		      struct stat *st)
+{
+  struct dumpdir *dump = dir ? dir->dump : NULL;
+  if (!dump || !dump->stv)
+    return false;
+
+  char **ptr = bsearch (&name, dump->elv, dump->elc, sizeof (dump->elv[0]),
+			compare_dirnames);
+  if (!ptr || !dump->stv[ptr - dump->elv])
+    return false;
+
+  struct stat **slot = &dump->stv[ptr - dump->elv];
+  *st = **slot;
+  kept_stats--;
+  stats_free (STATS_MEM_DIRECTORIES, sizeof **slot);
+  free (*slot);
+  *slot = NULL;
+  return true;
+}
+
 /* A "safe" version of directory_contents, which never returns NULL. */
 const char *
 safe_directory_contents (struct directory *dir)
@@ -947,7 +1367,8 @@ store_rename (struct directory *dir, struct obstack *stk)
   if (prev == NULL)
     {
       for (p = dir; p && p->orig; p = p->orig)
-	obstack_code_rename (stk, p->orig->name, p->name);
+	obstack_code_rename (stk, directory_name (p->orig),
+			     directory_name (p));
     }
   else
     {
@@ -956,16 +1377,17 @@ store_rename (struct directory *dir, struct obstack *stk)
       /* Break the cycle by using a temporary name for one of its
 	 elements.
 	 First, create a temp name stub entry. */
-      temp_name = dir_name (dir->name);
+      temp_name = dir_name (directory_name (dir));
       obstack_1grow (stk, 'X');
       obstack_grow (stk, temp_name, strlen (temp_name) + 1);
 
-      obstack_code_rename (stk, dir->name, "");
+      obstack_code_rename (stk, directory_name (dir), "");
 
       for (p = dir; p != prev; p = p->orig)
-	obstack_code_rename (stk, p->orig->name, p->name);
+	obstack_code_rename (stk, directory_name (p->orig),
+			     directory_name (p));
 
-      obstack_code_rename (stk, "", prev->name);
+      obstack_code_rename (stk, "", directory_name (prev));
       free (temp_name);
     }
 }
@@ -1015,9 +1437,116 @@ static FILE *listed_incremental_stream;
 
    The current tar version supports incremental versions from
    0 up to TAR_INCREMENTAL_VERSION, inclusive.
-   It is able to create only snapshots of TAR_INCREMENTAL_VERSION */
+   It creates snapshots of TAR_JOURNAL_VERSION with --snapshot-journal,
+   and of TAR_SNAPSHOT_VERSION otherwise.  */
+
+enum
+  {
+    TAR_SNAPSHOT_VERSION = 2,	/* Plain snapshot */
+    TAR_JOURNAL_VERSION = 3,	/* Snapshot followed by deltas */
+    TAR_INCREMENTAL_VERSION = TAR_JOURNAL_VERSION
+  };
+
+/* Version of the snapshot file read, or -1 if none was read.  */
+static int snapshot_version = -1;
+
+/* Size of the base part of the snapshot file, which precedes any
+   deltas, and of the whole file.  */
+static off_t snapshot_base_size;
+static off_t snapshot_size;
+
+/* Append to STK the record of DIRECTORY in a snapshot file of
+   version 2 or 3.  */
+static void
+obstack_directory_record (struct obstack *stk, struct directory *directory)
+{
+  char buf[SYSINT_BUFSIZE];
+  char const *s;
+
+  obstack_grow (stk, dir_is_nfs (directory) ? "1" : "0", 2);
+  s = timetostr (directory->mtime.tv_sec, buf);
+  obstack_grow (stk, s, strlen (s) + 1);
+  s = imaxtostr (directory->mtime.tv_nsec, buf);
+  obstack_grow (stk, s, strlen (s) + 1);
+  s = sysinttostr (directory->st_dev,
+		   TYPE_MINIMUM (dev_t), TYPE_MAXIMUM (dev_t), buf);
+  obstack_grow (stk, s, strlen (s) + 1);
+  s = sysinttostr (directory->st_ino,
+		   TYPE_MINIMUM (ino_t), TYPE_MAXIMUM (ino_t), buf);
+  obstack_grow (stk, s, strlen (s) + 1);
+
+  s = directory_name (directory);
+  obstack_grow (stk, s, strlen (s) + 1);
+  if (directory->dump)
+    {
+      const char *p;
+      struct dumpdir_iter *itr;
+
+      for (p = dumpdir_first (directory->dump, false, &itr);
+	   p;
+	   p = dumpdir_next (itr))
+	obstack_grow (stk, p, strlen (p) + 1);
+      free (itr);
+    }
+  obstack_grow (stk, "\0\0", 2);
+}
+
+/* Return a hash of the SIZE bytes at P.  */
+static uintmax_t
+hash_record (char const *p, idx_t size)
+{
+  uintmax_t h = 0xcbf29ce484222325u;
+  for (idx_t i = 0; i < size; i++)
+    h = (h ^ (unsigned char) p[i]) * 0x100000001b3u;
+  return h;
+}
+
+/* Record that DIRECTORY was read from the snapshot file.  Remember the
+   hash of its record, so that a delta need not repeat it if it does
+   not change.  */
+static void
+note_snapshot_directory (struct directory *directory)
+{
+  struct obstack stk;
+  obstack_init (&stk);
+  obstack_directory_record (&stk, directory);
+  directory->record_hash = hash_record (obstack_base (&stk),
+					obstack_object_size (&stk));
+  obstack_free (&stk, NULL);
+
+  if (snapshot_dirs_count == snapshot_dirs_alloc)
+    {
+      idx_t alloc = snapshot_dirs_alloc;
+      snapshot_dirs = xpalloc (snapshot_dirs, &snapshot_dirs_alloc, 1, -1,
+			       sizeof *snapshot_dirs);
+      stats_alloc (STATS_MEM_DIRECTORIES,
+		   (snapshot_dirs_alloc - alloc) * sizeof *snapshot_dirs);
+    }
+  directory->ordinal = snapshot_dirs_count;
+  snapshot_dirs[snapshot_dirs_count++] = directory;
+}
+
+/* Forget the directory with index ORDINAL in snapshot_dirs, as a delta
+   of the snapshot file says.  Its entry stays in the directory list,
+   where nothing looks at it any more.  */
+static void
+remove_snapshot_directory (intmax_t ordinal)
+{
+  struct directory *directory;
 
-enum { TAR_INCREMENTAL_VERSION = 2 };
+  if (! (0 <= ordinal && ordinal < snapshot_dirs_count
+	 && (directory = snapshot_dirs[ordinal])))
+    paxfatal (0, _("%s: byte %jd: %s"),
+	      quotearg_colon (listed_incremental_option),
+	      intmax (ftello (listed_incremental_stream)),
+	      _("Invalid directory index"));
+
+  hash_remove (directory_table, directory);
+  if (hash_lookup (directory_meta_table, directory) == directory)
+    hash_remove (directory_meta_table, directory);
+  directory->ordinal = -1;
+  snapshot_dirs[ordinal] = NULL;
+}
 
 /* Read incremental snapshot formats 0 and 1 */
 static void
@@ -1228,7 +1757,9 @@ read_timespec (FILE *fp, struct timespec *pval)
     }
 }
 
-/* Read incremental snapshot format 2 */
+/* Read incremental snapshot formats 2 and 3.  Format 3 is format 2
+   followed by any number of deltas, each of which begins with the
+   time of the dump that appended it.  */
 static void
 read_incr_db_2 (void)
 {
@@ -1238,6 +1769,7 @@ read_incr_db_2 (void)
   obstack_init (&stk);
 
   read_timespec (listed_incremental_stream, &newer_mtime_option);
+  snapshot_base_size = -1;
 
   for (;;)
     {
@@ -1250,8 +1782,43 @@ read_incr_db_2 (void)
       char *content;
       idx_t s;
 
+      if (snapshot_version == TAR_JOURNAL_VERSION)
+	{
+	  int c = getc (listed_incremental_stream);
+	  if (c == '+' || c == '-')
+	    {
+	      if (getc (listed_incremental_stream) != 0)
+		paxfatal (0, _("%s: byte %s: %s"),
+			  quotearg_colon (listed_incremental_option),
+			  offtostr (ftello (listed_incremental_stream), offbuf),
+			  _("Invalid delta marker"));
+	      if (c == '+')
+		{
+		  if (snapshot_base_size < 0)
+		    snapshot_base_size = ftello (listed_incremental_stream) - 2;
+		  read_timespec (listed_incremental_stream,
+				 &newer_mtime_option);
+		}
+	      else if (read_num (listed_incremental_stream, "index",
+				 0, IDX_MAX, &i))
+		remove_snapshot_directory (i);
+	      else
+		break;
+	      continue;
+	    }
+	  if (c != EOF)
+	    ungetc (c, listed_incremental_stream);
+	}
+
       if (! read_num (listed_incremental_stream, "nfs", 0, 1, &i))
-	return; /* Normal return */
+	{
+	  /* Normal return */
+	  snapshot_size = ftello (listed_incremental_stream);
+	  if (snapshot_base_size < 0)
+	    snapshot_base_size = snapshot_size;
+	  obstack_free (&stk, NULL);
+	  return;
+	}
 
       nfs = i;
 
@@ -1281,7 +1848,8 @@ read_incr_db_2 (void)
 		  _("Missing record terminator"));
 
       content = obstack_finish (&stk);
-      note_directory (name, mtime, dev, ino, nfs, false, content);
+      note_snapshot_directory (note_directory (name, mtime, dev, ino,
+					       nfs, false, content));
       obstack_free (&stk, content);
     }
   paxfatal (0, "%s: %s", quotearg_colon (listed_incremental_option),
@@ -1396,6 +1964,7 @@ read_directory_file (void)
 	}
       else
 	incremental_version = 0;
+      snapshot_version = incremental_version;
 
       switch (incremental_version)
 	{
@@ -1404,7 +1973,8 @@ read_directory_file (void)
 	  read_incr_db_01 (incremental_version, &buf, &bufsize);
 	  break;
 
-	case TAR_INCREMENTAL_VERSION:
+	case TAR_SNAPSHOT_VERSION:
+	case TAR_JOURNAL_VERSION:
 	  read_incr_db_2 ();
 	  break;
 
@@ -1418,48 +1988,47 @@ read_directory_file (void)
   free (buf);
 }
 
-/* Output incremental data for the directory ENTRY to the file DATA.
+struct snapshot_writer
+{
+  FILE *fp;			/* Snapshot file */
+  struct obstack stk;		/* Record being written */
+  bool delta;			/* Write only the changes */
+};
+
+/* Output incremental data for the directory ENTRY to the snapshot
+   writer DATA.  In a delta, output it only if its record changed, and
+   output the removal of its previous record, if any.
    Return nonzero if successful, preserving errno on write failure.  */
 static bool
 write_directory_file_entry (void *entry, void *data)
 {
-  struct directory const *directory = entry;
-  FILE *fp = data;
+  struct directory *directory = entry;
+  struct snapshot_writer *w = data;
+  bool journaled = w->delta && 0 <= directory->ordinal;
+  char *record = NULL;
+  idx_t size = 0;
 
   if (dir_is_found (directory))
     {
-      char buf[SYSINT_BUFSIZE];
-      char const *s;
-
-      s = dir_is_nfs (directory) ? "1" : "0";
-      fwrite (s, 2, 1, fp);
-      s = timetostr (directory->mtime.tv_sec, buf);
-      fwrite (s, strlen (s) + 1, 1, fp);
-      int ns = directory->mtime.tv_nsec;
-      fprintf (fp, "%d%c", ns, 0);
-      s = sysinttostr (directory->st_dev,
-		       TYPE_MINIMUM (dev_t), TYPE_MAXIMUM (dev_t), buf);
-      fwrite (s, strlen (s) + 1, 1, fp);
-      s = sysinttostr (directory->st_ino,
-		       TYPE_MINIMUM (ino_t), TYPE_MAXIMUM (ino_t), buf);
-      fwrite (s, strlen (s) + 1, 1, fp);
-
-      fwrite (directory->name, strlen (directory->name) + 1, 1, fp);
-      if (directory->dump)
+      obstack_directory_record (&w->stk, directory);
+      size = obstack_object_size (&w->stk);
+      record = obstack_finish (&w->stk);
+      if (journaled && hash_record (record, size) == directory->record_hash)
 	{
-	  const char *p;
-	  struct dumpdir_iter *itr;
-
-	  for (p = dumpdir_first (directory->dump, false, &itr);
-	       p;
-	       p = dumpdir_next (itr))
-	    fwrite (p, strlen (p) + 1, 1, fp);
-	  free (itr);
+	  obstack_free (&w->stk, record);
+	  return true;
 	}
-      fwrite ("\0\0", 2, 1, fp);
     }
 
-  return ! ferror (fp);
+  if (journaled)
+    fprintf (w->fp, "-%c%jd%c", 0, intmax (directory->ordinal), 0);
+  if (record)
+    {
+      fwrite (record, size, 1, w->fp);
+      obstack_free (&w->stk, record);
+    }
+
+  return ! ferror (w->fp);
 }
 
 void
@@ -1469,20 +2038,45 @@ write_directory_file (void)
   if (! fp)
     return;
 
-  if (fseeko (fp, 0, SEEK_SET) < 0)
-    seek_error (listed_incremental_option);
-  if (sys_truncate (fileno (fp)) < 0)
-    truncate_error (listed_incremental_option);
-
   int nsec = start_time.tv_nsec;
   char buf[SYSINT_BUFSIZE];
-  fprintf (fp, "%s-%s-%d\n%s%c%d%c",
-	   PACKAGE_NAME, PACKAGE_VERSION, TAR_INCREMENTAL_VERSION,
-	   timetostr (start_time.tv_sec, buf),
-	   0, nsec, 0);
+  struct snapshot_writer w;
+  w.fp = fp;
+  obstack_init (&w.stk);
+
+  /* Append a delta to a journal whose deltas, taken together, are
+     no larger than its base, and rewrite it otherwise, so that the
+     time spent reading it stays proportional to the size of the tree
+     and the time spent writing it proportional to the changes.  */
+  w.delta = (snapshot_journal_option
+	     && snapshot_version == TAR_JOURNAL_VERSION
+	     && snapshot_size - snapshot_base_size <= snapshot_base_size);
+
+  if (w.delta)
+    {
+      if (fseeko (fp, 0, SEEK_END) < 0)
+	seek_error (listed_incremental_option);
+      fprintf (fp, "+%c%s%c%d%c", 0,
+	       timetostr (start_time.tv_sec, buf), 0, nsec, 0);
+    }
+  else
+    {
+      if (fseeko (fp, 0, SEEK_SET) < 0)
+	seek_error (listed_incremental_option);
+      if (sys_truncate (fileno (fp)) < 0)
+	truncate_error (listed_incremental_option);
+
+      fprintf (fp, "%s-%s-%d\n%s%c%d%c",
+	       PACKAGE_NAME, PACKAGE_VERSION,
+	       (snapshot_journal_option
+		? TAR_JOURNAL_VERSION : TAR_SNAPSHOT_VERSION),
+	       timetostr (start_time.tv_sec, buf),
+	       0, nsec, 0);
+    }
 
   if (! ferror (fp) && directory_table)
-    hash_do_for_each (directory_table, write_directory_file_entry, fp);
+    hash_do_for_each (directory_table, write_directory_file_entry, &w);
+  obstack_free (&w.stk, NULL);
 
   if (ferror (fp))
     write_error (listed_incremental_option);
@@ -1765,6 +2359,288 @@ purge_directory (char const *directory_name)
   free (current_dir);
 }
 
+/* Restore planning.  When a chain of incremental archives is extracted
+   in one run with --separate-archives, the headers of all the archives
+   are read first.  A member is then extracted only from the last
+   archive that holds it, and only if the directory containing it still
+   lists it at the end of the chain.  Since only the last version of a
+   directory is extracted, each directory is purged once, against its
+   final dumpdir, and every file is written at most once.  */
+
+struct plan_entry
+{
+  char *name;			/* Member name */
+  idx_t archive;		/* Index of the last archive holding it */
+  struct dumpdir *dump;		/* Its dumpdir in that archive, if any */
+  char *link;			/* Target, if it is a hard link there */
+};
+
+static Hash_table *plan_table;
+
+/* Index of the archive being read.  */
+static idx_t plan_archive;
+
+/* True if the chain cannot be followed by a plan, e.g. because it
+   renames directories.  */
+static bool plan_abandoned;
+
+/* The members to extract from the archive being read.  */
+static enum restore_phase plan_phase;
+
+static size_t
+hash_plan_entry (void const *entry, size_t n_buckets)
+{
+  struct plan_entry const *e = entry;
+  return hash_string (e->name, n_buckets);
+}
+
+static bool
+compare_plan_entries (void const *entry1, void const *entry2)
+{
+  struct plan_entry const *e1 = entry1;
+  struct plan_entry const *e2 = entry2;
+  return streq (e1->name, e2->name);
+}
+
+/* Set the hard link target of E to a copy of LINK, or to none if LINK
+   is null.  */
+static void
+plan_entry_set_link (struct plan_entry *e, char const *link)
+{
+  if (e->link)
+    {
+      stats_free (STATS_MEM_DIRECTORIES, strlen (e->link) + 1);
+      free (e->link);
+      e->link = NULL;
+    }
+  if (link)
+    {
+      e->link = xstrdup (link);
+      stats_alloc (STATS_MEM_DIRECTORIES, strlen (link) + 1);
+    }
+}
+
+static void
+free_plan_entry (void *entry)
+{
+  struct plan_entry *e = entry;
+  stats_free (STATS_MEM_DIRECTORIES, sizeof *e + strlen (e->name) + 1);
+  if (e->dump)
+    dumpdir_free (e->dump);
+  plan_entry_set_link (e, NULL);
+  free (e->name);
+  free (e);
+}
+
+static struct plan_entry *
+plan_lookup (char *name)
+{
+  struct plan_entry key;
+  key.name = name;
+  return hash_lookup (plan_table, &key);
+}
+
+/* Return true if the COUNT archives named by NAMES can be extracted
+   following a restore plan.  The archives are read twice, so they must
+   be regular files.  The options that make extraction depend on the
+   files extracted from earlier archives, or that extract only some of
+   the members, rule out a plan.  */
+bool
+restore_plan_wanted (char const *const *names, idx_t count)
+{
+  if (! (incremental_option && 1 < count && name_list_selects_all ()
+	 && !starting_file_option && !occurrence_option
+	 && !interactive_option && !to_stdout_option && !to_command_option
+	 && !backup_option && old_files_option < KEEP_OLD_FILES
+	 && !time_option_initialized (newer_mtime_option)))
+    return false;
+
+  for (idx_t i = 0; i < count; i++)
+    {
+      struct stat st;
+      if (stat (names[i], &st) != 0 || !S_ISREG (st.st_mode))
+	return false;
+    }
+  return true;
+}
+
+/* Start reading the archive with index ARCHIVE.  */
+void
+restore_plan_archive (idx_t archive)
+{
+  plan_archive = archive;
+}
+
+/* Add the current member of the archive being read to the plan.  */
+void
+restore_plan_note (void)
+{
+  if (plan_abandoned)
+    return;
+  if (memory_limit_reached ())
+    {
+      plan_abandoned = true;
+      return;
+    }
+
+  if (! (plan_table
+	 || (plan_table = hash_initialize (0, NULL, hash_plan_entry,
+					   compare_plan_entries,
+					   free_plan_entry))))
+    xalloc_die ();
+
+  struct plan_entry *e = plan_lookup (current_stat_info.file_name);
+  if (!e)
+    {
+      e = xmalloc (sizeof *e);
+      e->name = xstrdup (current_stat_info.file_name);
+      e->dump = NULL;
+      e->link = NULL;
+      if (!hash_insert (plan_table, e))
+	xalloc_die ();
+      stats_alloc (STATS_MEM_DIRECTORIES, sizeof *e + strlen (e->name) + 1);
+    }
+  e->archive = plan_archive;
+  plan_entry_set_link (e, (current_header->header.typeflag == LNKTYPE
+			   ? current_stat_info.link_name : NULL));
+
+  if (e->dump)
+    {
+      dumpdir_free (e->dump);
+      e->dump = NULL;
+    }
+  if (is_dumpdir (&current_stat_info))
+    {
+      for (char const *p = current_stat_info.dumpdir; *p; p += strlen (p) + 1)
+	if (*p == 'R' || *p == 'X')
+	  plan_abandoned = true;
+      e->dump = dumpdir_create (current_stat_info.dumpdir);
+    }
+}
+
+/* Return true if the member NAME is gone at the end of the chain,
+   because a directory containing it no longer lists the next
+   directory down.  */
+static bool
+plan_gone_p (char const *name)
+{
+  char *buf = xstrdup (name);
+  bool gone = false;
+
+  for (idx_t len = strlen (buf); !gone; )
+    {
+      idx_t base = len;
+      while (0 < base && !ISSLASH (buf[base - 1]))
+	base--;
+      idx_t dirlen = base;
+      while (0 < dirlen && ISSLASH (buf[dirlen - 1]))
+	dirlen--;
+      if (dirlen == 0)
+	break;
+
+      buf[len] = 0;
+      buf[dirlen] = 0;
+      struct plan_entry *e = plan_lookup (buf);
+      if (e && e->dump)
+	gone = !dumpdir_locate (e->dump, buf + base);
+      len = dirlen;
+    }
+
+  free (buf);
+  return gone;
+}
+
+/* Return true unless the hard link ENTRY, if it is one, would be
+   extracted before its target or after the target is removed: the
+   target is extracted from a later archive, which replaced it, or not
+   at all.  Extracting the chain without a plan links to the version
+   of the target that the link was archived with.  */
+static bool
+plan_entry_linkable_p (void *entry, MAYBE_UNUSED void *data)
+{
+  struct plan_entry *e = entry;
+  if (!e->link)
+    return true;
+  struct plan_entry *target = plan_lookup (e->link);
+  return (target && target->archive <= e->archive
+	  && !plan_gone_p (target->name));
+}
+
+/* Finish planning.  COMPLETE tells whether all the archives were read
+   to their end; if not, or if the plan was abandoned, extract every
+   member as usual.  Return true if the plan is to be followed.  */
+bool
+restore_plan_finish (bool complete)
+{
+  if (complete && !plan_abandoned && plan_table
+      && (hash_do_for_each (plan_table, plan_entry_linkable_p, NULL)
+	  == hash_get_n_entries (plan_table)))
+    return true;
+  restore_plan_free ();
+  return false;
+}
+
+static bool
+plan_entry_local_p (void *entry, MAYBE_UNUSED void *data)
+{
+  struct plan_entry *e = entry;
+  struct plan_entry *target;
+  return ! (e->link && (target = plan_lookup (e->link))
+	    && target->archive != e->archive);
+}
+
+/* Return true if the archives of the plan can be extracted at once,
+   once their directories exist.  The members extracted from different
+   archives have different names, so this is so unless a hard link is
+   to a file extracted from another archive.  restore_plan_finish made
+   sure that such a file comes from an earlier archive, so extracting
+   the archives one after the other still follows the plan safely.  */
+bool
+restore_plan_parallel_p (void)
+{
+  return (plan_table
+	  && (hash_do_for_each (plan_table, plan_entry_local_p, NULL)
+	      == hash_get_n_entries (plan_table)));
+}
+
+/* Extract only the members of the archives that PHASE says.  */
+void
+restore_plan_phase (enum restore_phase phase)
+{
+  plan_phase = phase;
+}
+
+void
+restore_plan_free (void)
+{
+  if (plan_table)
+    {
+      hash_free (plan_table);
+      plan_table = NULL;
+    }
+  plan_abandoned = false;
+  plan_phase = RESTORE_ALL;
+}
+
+/* Return true if the member NAME of the archive being read need not be
+   extracted, because a later archive holds it, because it is gone at
+   the end of the chain, or because it is not to be extracted in the
+   current phase.  DIRECTORY tells whether the member is a directory.  */
+bool
+restore_plan_skip (char const *name, bool directory)
+{
+  if (!plan_table)
+    return false;
+  if (plan_phase != RESTORE_ALL
+      && directory != (plan_phase == RESTORE_DIRECTORIES))
+    return true;
+
+  char *buf = xstrdup (name);
+  struct plan_entry *e = plan_lookup (buf);
+  free (buf);
+  return (e && e->archive != plan_archive) || plan_gone_p (name);
+}
+
 void
 list_dumpdir (char *buffer, idx_t size)
 {
@@ -194,21 +194,47 @@ transform_stat_info (char typeflag, struct tar_stat_info *stat_info)
   return true;
 }
 
-/* Main loop for reading an archive.  */
-void
-read_and (void (*do_something) (void))
+/* Storage for the strings of current_stat_info that are set only by
+   the header decoders, so that they need not be freed one by one when
+   moving on to the next member.  MEMBER_ARENA_BASE is the first object
+   ever allocated from it; freeing it empties the arena but keeps its
+   first chunk for reuse.  */
+static struct obstack member_arena;
+static void *member_arena_base;
+
+/* Release everything allocated from the member arena.  */
+static void
+member_arena_reset (void)
+{
+  if (!member_arena_base)
+    {
+      obstack_init (&member_arena);
+      member_arena_base = obstack_alloc (&member_arena, 0);
+    }
+  else
+    obstack_free (&member_arena, member_arena_base);
+}
+
+/* Read the archive named by archive_name_array[0], calling
+   DO_SOMETHING for each member that matches the name list.  */
+static void
+read_archive (void (*do_something) (void))
 {
   enum read_header status = HEADER_STILL_UNREAD;
   enum read_header prev_status;
   struct timespec mtime;
 
-  name_gather ();
-
+  /* The listing of an earlier archive may still be buffered: do not
+     let a child forked by open_archive write it out as well.  */
+  if (separate_archives_option)
+    fflush (NULL);
   open_archive (ACCESS_READ);
   do
     {
       prev_status = status;
       tar_stat_destroy (&current_stat_info);
+      member_arena_reset ();
+      current_stat_info.arena = &member_arena;
 
       status = read_header (&current_header, &current_stat_info,
                             read_header_auto);
@@ -257,7 +283,10 @@ read_and (void (*do_something) (void))
 
 	  if (transform_stat_info (current_header->header.typeflag,
 				   &current_stat_info))
-	    (*do_something) ();
+	    {
+	      stats_count_member ();
+	      (*do_something) ();
+	    }
 	  else
 	    skip_member ();
 	  continue;
@@ -329,6 +358,163 @@ read_and (void (*do_something) (void))
   while (!all_names_found (&current_stat_info));
 
   close_archive ();
+}
+
+/* Read the headers of the archive named by archive_name_array[0],
+   calling NOTE for each member that is not excluded, and skipping the
+   member data.  Return false if the archive could not be read to its
+   end.  */
+static bool
+scan_archive (void (*note) (void))
+{
+  enum read_header status;
+
+  if (separate_archives_option)
+    fflush (NULL);
+  open_archive (ACCESS_READ);
+  for (;;)
+    {
+      tar_stat_destroy (&current_stat_info);
+      member_arena_reset ();
+      current_stat_info.arena = &member_arena;
+
+      status = read_header (&current_header, &current_stat_info,
+			    read_header_auto);
+      if (status == HEADER_ZERO_BLOCK)
+	{
+	  set_next_block_after (current_header);
+	  if (!ignore_zeros_option)
+	    break;
+	  continue;
+	}
+      if (status != HEADER_SUCCESS)
+	break;
+
+      decode_header (current_header, &current_stat_info,
+		     &current_format, true);
+      if (! excluded_name (current_stat_info.file_name,
+			   current_stat_info.parent)
+	  && transform_stat_info (current_header->header.typeflag,
+				  &current_stat_info))
+	(*note) ();
+      skip_member ();
+    }
+  close_archive ();
+  return status != HEADER_FAILURE;
+}
+
+/* Extract COUNT archives in child processes, at most jobs_option of
+   them at a time: a new one is started as soon as any of the running
+   ones exits.  The parent has no other children by now.  Return the
+   index of the archive to extract in the children, and -1 in the
+   parent, once all of them have exited.  */
+static idx_t
+fork_extractors (idx_t count)
+{
+  idx_t running = 0;
+
+  fflush (NULL);
+  for (idx_t i = 0; i < count; i++)
+    {
+      if (jobs_option <= running)
+	{
+	  sys_wait_for_shard (-1);
+	  running--;
+	}
+      pid_t pid = xfork ();
+      if (pid == 0)
+	{
+	  /* The parent sets the status of the directories once all the
+	     files are in them.  */
+	  forget_delayed_set_stat ();
+	  if (stats_file_option)
+	    {
+	      char *name = xmalloc (strlen (stats_file_option)
+				    + INT_BUFSIZE_BOUND (intmax_t) + 1);
+	      sprintf (name, "%s.%jd", stats_file_option, intmax (i));
+	      stats_file_option = name;
+	    }
+	  return i;
+	}
+      running++;
+    }
+
+  for (; 0 < running; running--)
+    sys_wait_for_shard (-1);
+
+  /* Each child has reported its own totals.  */
+  totals_option = false;
+  return -1;
+}
+
+/* Main loop for reading an archive.  With --separate-archives, read
+   each of the archives in turn, sharing the name list, so that a name
+   is reported as not found only if no archive has it.  When extracting
+   a chain of incremental archives, read the headers of all of them
+   first, to extract only the last version of each member.  With
+   --jobs, then make the directories and extract the other members of
+   each archive in a process of its own.  */
+void
+read_and (void (*do_something) (void))
+{
+  name_gather ();
+
+  if (!separate_archives_option)
+    read_archive (do_something);
+  else
+    {
+      const char **names = archive_name_array;
+      idx_t count = archive_names;
+      const char *compress_program = use_compress_program_option;
+      idx_t first = 0, last = count;
+
+      archive_names = 1;
+      if (subcommand_option == EXTRACT_SUBCOMMAND
+	  && restore_plan_wanted (names, count))
+	{
+	  bool complete = true;
+	  for (idx_t i = 0; complete && i < count; i++)
+	    {
+	      archive_name_array = archive_name_cursor = names + i;
+	      use_compress_program_option = compress_program;
+	      restore_plan_archive (i);
+	      complete = scan_archive (restore_plan_note);
+	    }
+	  if (restore_plan_finish (complete)
+	      && 1 < jobs_option && restore_plan_parallel_p ())
+	    {
+	      /* Listings from the processes go out a line at a time, so
+		 that they do not mix.  */
+	      setvbuf (stdlis, NULL, _IOLBF, 0);
+	      restore_plan_phase (RESTORE_DIRECTORIES);
+	      for (idx_t i = 0; i < count; i++)
+		{
+		  archive_name_array = archive_name_cursor = names + i;
+		  use_compress_program_option = compress_program;
+		  restore_plan_archive (i);
+		  read_archive (do_something);
+		}
+	      restore_plan_phase (RESTORE_FILES);
+	      idx_t i = fork_extractors (count);
+	      first = i < 0 ? 0 : i;
+	      last = i < 0 ? 0 : i + 1;
+	    }
+	}
+
+      for (idx_t i = first; i < last; i++)
+	{
+	  archive_name_array = archive_name_cursor = names + i;
+	  /* The compression program may have been guessed from the
+	     suffix of the previous archive.  */
+	  use_compress_program_option = compress_program;
+	  restore_plan_archive (i);
+	  read_archive (do_something);
+	}
+      restore_plan_free ();
+      archive_name_array = archive_name_cursor = names;
+      archive_names = count;
+    }
+
   names_notfound ();		/* print names not found */
 }
 
@@ -403,6 +589,58 @@ tar_checksum (union block *header, bool silent)
   return HEADER_SUCCESS;
 }
 
+/* Storage for GNU long names and links that cannot be used where
+   they lie in the archive record.  It is reused from one member to
+   the next, and so are RECENT_LONG_NAME and RECENT_LONG_LINK.  */
+static union block *long_name_buffer;
+static union block *long_link_buffer;
+static idx_t long_name_buffer_size;
+static idx_t long_link_buffer_size;
+
+/* Return *BUFFER, of allocated size *BUFFER_SIZE, after making sure
+   it can hold SIZE bytes and a terminating null.  */
+static union block *
+long_name_storage (union block **buffer, idx_t *buffer_size, idx_t size)
+{
+  if (*buffer_size <= size)
+    {
+      free (*buffer);
+      *buffer = xmalloc (size + 1);
+      *buffer_size = size + 1;
+    }
+  return *buffer;
+}
+
+/* If *NAME, a long name header followed by the rest of its BLOCKS
+   blocks, is in the archive record, copy it to *BUFFER.  */
+static void
+keep_long_name (union block **name, union block **buffer,
+		idx_t *buffer_size, idx_t blocks)
+{
+  if (*name && *name != *buffer)
+    {
+      idx_t size = blocks << LG_BLOCKSIZE;
+      union block *copy = long_name_storage (buffer, buffer_size, size);
+      memcpy (copy, *name, size);
+      charptr (copy)[size] = '\0';
+      *name = copy;
+    }
+}
+
+/* The record is about to be refilled: copy the pending long NAME and
+   LINK, and the extended header of INFO, out of it.  */
+static void
+keep_in_place (struct tar_stat_info *info,
+	       union block **name, idx_t name_blocks,
+	       union block **link, idx_t link_blocks)
+{
+  keep_long_name (name, &long_name_buffer, &long_name_buffer_size,
+		  name_blocks);
+  keep_long_name (link, &long_link_buffer, &long_link_buffer_size,
+		  link_blocks);
+  xheader_keep (&info->xhdr);
+}
+
 /* Read a block that's supposed to be a header block.  Return its
    address in *RETURN_BLOCK, and if it is good, the file's size
    and names (file name, link name) in *INFO.
@@ -438,6 +676,11 @@ read_header (union block **return_block, struct tar_stat_info *info,
   idx_t next_long_link_blocks = 0;
   enum read_header status = HEADER_SUCCESS;
 
+  /* An extended header that the previous call left in the record
+     may have been overwritten since.  */
+  if (info->xhdr.borrowed)
+    xheader_destroy (&info->xhdr);
+
   while (1)
     {
       header = find_next_block ();
@@ -474,26 +717,41 @@ read_header (union block **return_block, struct tar_stat_info *info,
 	  else if (header->header.typeflag == GNUTYPE_LONGNAME
 		   || header->header.typeflag == GNUTYPE_LONGLINK)
 	    {
-	      union block *header_copy;
+	      bool longname = header->header.typeflag == GNUTYPE_LONGNAME;
+	      union block **next = longname ? &next_long_name : &next_long_link;
+
 	      if (ckd_add (&size, info->stat.st_size, 2 * BLOCKSIZE - 1))
 		xalloc_die ();
 	      size -= size & (BLOCKSIZE - 1);
 
-	      header_copy = xmalloc (size + 1);
-
-	      if (header->header.typeflag == GNUTYPE_LONGNAME)
-		{
-		  free (next_long_name);
-		  next_long_name = header_copy;
-		  next_long_name_blocks = size >> LG_BLOCKSIZE;
-		}
+	      if (longname)
+		next_long_name_blocks = size >> LG_BLOCKSIZE;
 	      else
+		next_long_link_blocks = size >> LG_BLOCKSIZE;
+
+	      if (fits_in_record (header, info->stat.st_size)
+		  && memchr (header + 1, '\0', size - BLOCKSIZE))
 		{
-		  free (next_long_link);
-		  next_long_link = header_copy;
-		  next_long_link_blocks = size >> LG_BLOCKSIZE;
+		  /* The name is null-terminated and the next header is
+		     in this record: use the name where it lies.  */
+		  *next = header;
+		  set_next_block_after (charptr (header) + size - 1);
+		  info->skipped = true;
+		  continue;
 		}
 
+	      *next = NULL;
+	      keep_in_place (info, &next_long_name, next_long_name_blocks,
+			     &next_long_link, next_long_link_blocks);
+
+	      union block *header_copy
+		= long_name_storage (longname ? &long_name_buffer
+				     : &long_link_buffer,
+				     longname ? &long_name_buffer_size
+				     : &long_link_buffer_size,
+				     size);
+	      *next = header_copy;
+
 	      set_next_block_after (header);
 	      *header_copy = *header;
 	      bp = charptr (header_copy + 1);
@@ -521,6 +779,10 @@ read_header (union block **return_block, struct tar_stat_info *info,
 	  else if (header->header.typeflag == XHDTYPE
 		   || header->header.typeflag == SOLARIS_XHDTYPE)
 	    {
+	      xheader_destroy (&info->xhdr);
+	      if (!fits_in_record (header, info->stat.st_size))
+		keep_in_place (info, &next_long_name, next_long_name_blocks,
+			       &next_long_link, next_long_link_blocks);
 	      xheader_read (&info->xhdr, header,
 			    OFF_FROM_HEADER (header->header.size));
 	      info->skipped = true;
@@ -534,6 +796,9 @@ read_header (union block **return_block, struct tar_stat_info *info,
 	      memcpy (recent_global_header, header,
 		      sizeof *recent_global_header);
 	      memset (&xhdr, 0, sizeof xhdr);
+	      if (!fits_in_record (header, info->stat.st_size))
+		keep_in_place (info, &next_long_name, next_long_name_blocks,
+			       &next_long_link, next_long_link_blocks);
 	      xheader_read (&xhdr, header,
 			    OFF_FROM_HEADER (header->header.size));
 	      xheader_decode_global (&xhdr);
@@ -571,14 +836,11 @@ read_header (union block **return_block, struct tar_stat_info *info,
 	      info->stat.st_size = 0;
 	    }
 
-	  free (recent_long_name);
-
 	  if (next_long_name)
 	    {
 	      name = charptr (next_long_name + 1);
 	      recent_long_name = next_long_name;
 	      recent_long_name_blocks = next_long_name_blocks;
-	      next_long_name = NULL;
 	    }
 	  else
 	    {
@@ -603,14 +865,11 @@ read_header (union block **return_block, struct tar_stat_info *info,
 	  assign_string (&info->file_name, name);
 	  info->had_trailing_slash = strip_trailing_slashes (info->file_name);
 
-	  free (recent_long_link);
-
 	  if (next_long_link)
 	    {
 	      name = charptr (next_long_link + 1);
 	      recent_long_link = next_long_link;
 	      recent_long_link_blocks = next_long_link_blocks;
-	      next_long_link = NULL;
 	    }
 	  else
 	    {
@@ -625,8 +884,11 @@ read_header (union block **return_block, struct tar_stat_info *info,
 	  break;
 	}
     }
-  free (next_long_name);
-  free (next_long_link);
+
+  /* Only a member header just returned may leave its extended header
+     in the record; otherwise the caller may read on before using it.  */
+  if (status != HEADER_SUCCESS)
+    xheader_keep (&info->xhdr);
   return status;
 }
 
@@ -680,12 +942,12 @@ decode_header (union block *header, struct tar_stat_info *stat_info,
   stat_info->stat.st_mode = mode;
   stat_info->mtime.tv_sec = TIME_FROM_HEADER (header->header.mtime);
   stat_info->mtime.tv_nsec = 0;
-  assign_string_n (&stat_info->uname,
-		   header->header.uname[0] ? header->header.uname : NULL,
-		   sizeof (header->header.uname));
-  assign_string_n (&stat_info->gname,
-		   header->header.gname[0] ? header->header.gname : NULL,
-		   sizeof (header->header.gname));
+  tar_stat_assign_n (stat_info, &stat_info->uname,
+		     header->header.uname[0] ? header->header.uname : NULL,
+		     sizeof (header->header.uname));
+  tar_stat_assign_n (stat_info, &stat_info->gname,
+		     header->header.gname[0] ? header->header.gname : NULL,
+		     sizeof (header->header.gname));
 
   xheader_xattr_init (stat_info);
 
@@ -760,6 +1022,68 @@ decode_header (union block *header, struct tar_stat_info *stat_info,
 }
 
 
+/* Return the 8 bytes at P as a word, the first byte being the most
+   significant one.  */
+static uint_fast64_t
+load_octal_word (char const *p)
+{
+  unsigned char const *u = (unsigned char const *) p;
+  uint_fast64_t w = 0;
+  for (int i = 0; i < 8; i++)
+    w = w << 8 | u[i];
+  return w;
+}
+
+/* If the word W holds eight octal digit characters, most significant
+   first, store their value in *VALUE and return true.  The digits are
+   checked and then combined pairwise in all lanes at once.  */
+static bool
+octal_word_value (uint_fast64_t w, uint_fast64_t *value)
+{
+  if ((w & 0xF8F8F8F8F8F8F8F8) != 0x3030303030303030)
+    return false;
+  w -= 0x3030303030303030;
+  w = ((w >> 8) & 0x00FF00FF00FF00FF) * 8 + (w & 0x00FF00FF00FF00FF);
+  w = ((w >> 16) & 0x0000FFFF0000FFFF) * 64 + (w & 0x0000FFFF0000FFFF);
+  *value = (w >> 32 & 0xFFFFFFFF) * 4096 + (w & 0xFFFFFFFF);
+  return true;
+}
+
+/* Fast path of from_header for the fields written by tar and most
+   other archivers: 8- and 12-byte fields made of zero-padded octal
+   digits and a null or space.  Store the value of the DIGS bytes at P
+   in *VALUE and return true if they have that form, else return false
+   so that the general parser can deal with them.  */
+static bool
+octal_field_value (char const *p, int digs, uint_fast64_t *value)
+{
+  if (! (p[digs - 1] == '\0' || p[digs - 1] == ' '))
+    return false;
+
+  uint_fast64_t hi;
+  switch (digs)
+    {
+    case 8:
+      /* Seven digits: pad with a leading '0'.  */
+      return octal_word_value (((uint_fast64_t) '0' << 56
+				| (load_octal_word (p) >> 8 & 0xFFFFFFFFFFFFFF)),
+			       value);
+
+    case 12:
+      /* Eleven digits: the first three padded with '0's, then eight.  */
+      if (! (octal_word_value ((0x3030303030000000
+				| (load_octal_word (p) >> 40 & 0xFFFFFF)),
+			       &hi)
+	     && octal_word_value (load_octal_word (p + 3), value)))
+	return false;
+      *value += hi << 24;
+      return true;
+
+    default:
+      return false;
+    }
+}
+
 /* Convert buffer at WHERE0 of size DIGS from external format to
    intmax_t.  DIGS must be positive.  If TYPE is nonnull, the data are
    of type TYPE.  The buffer must represent a value in the range
@@ -786,6 +1110,10 @@ from_header (char const *where0, int digs, char const *type,
   char const *lim = where + digs;
   bool negative = false;
 
+  uint_fast64_t fast;
+  if (octal_field_value (where0, digs, &fast) && fast <= maxval)
+    return represent_uintmax (fast);
+
   /* Accommodate buggy tar of unknown vintage, which outputs leading
      NUL if the previous field overflows.  */
   where += !*where;
@@ -25,6 +25,12 @@
 #include <unlinkdir.h>
 #include <utimens.h>
 
+#if HAVE_LINUX_FIEMAP_H
+# include <linux/fs.h>
+# include <linux/fiemap.h>
+# include <sys/ioctl.h>
+#endif
+
 #ifndef DOUBLE_SLASH_IS_DISTINCT_ROOT
 # define DOUBLE_SLASH_IS_DISTINCT_ROOT 0
 #endif
@@ -886,7 +892,117 @@ int
 deref_stat (char const *name, struct stat *buf)
 {
   struct fdbase f = fdbase (name);
-  return f.fd == BADFD ? -1 : fstatat (f.fd, f.base, buf, fstatat_flags);
+  return f.fd == BADFD ? -1 : deref_fstatat (f.fd, f.base, buf);
+}
+
+/* Likewise, for the file NAME relative to the directory FD.  */
+int
+deref_fstatat (int fd, char const *name, struct stat *buf)
+{
+  struct timespec start = stats_start ();
+  int r = fstatat (fd, name, buf, fstatat_flags);
+  stats_stop (STATS_STAT, start);
+  return r;
+}
+
+#ifdef HAVE_STATX
+/* True if the statx system call turned out not to be implemented.  */
+static bool statx_unsupported;
+
+/* Copy the status in *STX to *ST.  */
+static void
+statx_to_stat (struct statx const *stx, struct stat *st)
+{
+  st->st_dev = makedev (stx->stx_dev_major, stx->stx_dev_minor);
+  st->st_rdev = makedev (stx->stx_rdev_major, stx->stx_rdev_minor);
+  st->st_ino = stx->stx_ino;
+  st->st_mode = stx->stx_mode;
+  st->st_nlink = stx->stx_nlink;
+  st->st_uid = stx->stx_uid;
+  st->st_gid = stx->stx_gid;
+  st->st_size = stx->stx_size;
+  st->st_blksize = stx->stx_blksize;
+  st->st_blocks = stx->stx_blocks;
+  st->st_atim.tv_sec = stx->stx_atime.tv_sec;
+  st->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+  st->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+  st->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+  st->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+  st->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+#endif
+
+/* Set *BUF to the status of the file NAME in the directory FD, as
+   fstatat with FLAGS would, filling in only the members selected by
+   FIELDS.  Return 0 if successful, -1 (setting errno) on failure, and
+   1 if statx is not available.  */
+static int
+statx_fields (MAYBE_UNUSED int fd, MAYBE_UNUSED char const *name,
+	      MAYBE_UNUSED struct stat *buf, MAYBE_UNUSED int flags,
+	      MAYBE_UNUSED int fields)
+{
+#ifdef HAVE_STATX
+  if (fields != STAT_ALL && !statx_unsupported)
+    {
+      unsigned int mask = ((fields & STAT_TYPE ? STATX_TYPE : 0)
+			   | (fields & STAT_MODE ? STATX_TYPE | STATX_MODE : 0)
+			   | (fields & STAT_SIZE ? STATX_SIZE : 0)
+			   | (fields & STAT_MTIME ? STATX_MTIME : 0)
+			   | (fields & STAT_CTIME ? STATX_CTIME : 0)
+			   | (fields & STAT_INO ? STATX_INO : 0));
+      struct statx stx;
+      struct timespec start = stats_start ();
+      int r = statx (fd, name, flags, mask, &stx);
+      stats_stop (STATS_STAT, start);
+      if (r == 0)
+	{
+	  statx_to_stat (&stx, buf);
+	  return 0;
+	}
+      if (errno != ENOSYS)
+	return r;
+      statx_unsupported = true;
+    }
+#endif
+  return 1;
+}
+
+/* Like fstatat, but only the members of *BUF selected by FIELDS (a
+   combination of STAT_* flags) are needed; the others may be left
+   unset or out of date.  Where statx is available only the needed
+   members are asked for, so that network file systems need not fetch
+   the others from the server.  */
+int
+fstatat_fields (int fd, char const *name, struct stat *buf, int flags,
+		int fields)
+{
+  int r = statx_fields (fd, name, buf, flags, fields);
+  if (r <= 0)
+    return r;
+  struct timespec start = stats_start ();
+  r = fstatat (fd, name, buf, flags);
+  stats_stop (STATS_STAT, start);
+  return r;
+}
+
+/* Likewise, for deref_fstatat.  */
+int
+deref_fstatat_fields (int fd, char const *name, struct stat *buf,
+		      int fields)
+{
+  return fstatat_fields (fd, name, buf, fstatat_flags, fields);
+}
+
+/* Likewise, for fstat.  */
+int
+fstat_fields (int fd, struct stat *buf, int fields)
+{
+#ifdef AT_EMPTY_PATH
+  int r = statx_fields (fd, "", buf, AT_EMPTY_PATH, fields);
+  if (r <= 0)
+    return r;
+#endif
+  return fstat (fd, buf);
 }
 
 /* Read from FD into the buffer BUF with COUNT bytes.  Attempt to fill
@@ -898,6 +1014,7 @@ deref_stat (char const *name, struct stat *buf)
 idx_t
 blocking_read (int fd, void *buf, idx_t count)
 {
+  struct timespec start = stats_start ();
   idx_t bytes = full_read (fd, buf, count);
 
 #if defined F_SETFL && O_NONBLOCK
@@ -914,6 +1031,7 @@ blocking_read (int fd, void *buf, idx_t count)
     }
 #endif
 
+  stats_stop (STATS_FILE_READ, start);
   return bytes;
 }
 
@@ -926,6 +1044,7 @@ blocking_read (int fd, void *buf, idx_t count)
 idx_t
 blocking_write (int fd, void const *buf, idx_t count)
 {
+  struct timespec start = stats_start ();
   idx_t bytes = full_write (fd, buf, count);
 
 #if defined F_SETFL && O_NONBLOCK
@@ -941,6 +1060,7 @@ blocking_write (int fd, void const *buf, idx_t count)
     }
 #endif
 
+  stats_stop (STATS_FILE_WRITE, start);
   return bytes;
 }
 
@@ -1683,6 +1803,129 @@ namebuf_finish (namebuf_t buf)
   return res;
 }
 
+/* With --sort=extent, a directory entry and its sort keys.  */
+struct extent_entry
+{
+  uintmax_t offset;		/* Physical offset of its data, or 0 */
+  uintmax_t ino;		/* Inode number, or 0 */
+  char const *name;		/* Entry name */
+};
+
+/* True if the entries being sorted are to be ordered by inode number,
+   as the file system cannot tell where their data are.  */
+static bool extent_by_inode;
+
+static int
+compare_extent_entries (void const *first, void const *second)
+{
+  struct extent_entry const *e1 = first;
+  struct extent_entry const *e2 = second;
+  uintmax_t k1 = extent_by_inode ? e1->ino : e1->offset;
+  uintmax_t k2 = extent_by_inode ? e2->ino : e2->offset;
+  if (k1 != k2)
+    return k1 < k2 ? -1 : 1;
+  return strcmp (e1->name, e2->name);
+}
+
+/* Return the physical offset of the first extent of the regular file
+   NAME in the directory DIRFD, or 0 if it is not known.  Set
+   *UNSUPPORTED if the file system cannot tell.  */
+static uintmax_t
+first_extent_offset (int dirfd, char const *name, bool *unsupported)
+{
+#if HAVE_LINUX_FIEMAP_H && defined FS_IOC_FIEMAP
+  union
+  {
+    struct fiemap map;
+    char buf[sizeof (struct fiemap) + sizeof (struct fiemap_extent)];
+  } m;
+  uintmax_t offset = 0;
+  int fd = openat (dirfd, name,
+		   O_RDONLY | O_NOCTTY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0)
+    return 0;
+
+  memset (&m, 0, sizeof m);
+  m.map.fm_length = FIEMAP_MAX_OFFSET;
+  m.map.fm_extent_count = 1;
+  if (ioctl (fd, FS_IOC_FIEMAP, &m.map) < 0)
+    *unsupported = (errno == ENOTTY || errno == ENOTSUP
+		    || (EOPNOTSUPP != ENOTSUP && errno == EOPNOTSUPP));
+  else if (m.map.fm_mapped_extents
+	   && ! (m.map.fm_extents[0].fe_flags
+		 & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE)))
+    offset = m.map.fm_extents[0].fe_physical;
+  close (fd);
+  return offset;
+#else
+  *unsupported = true;
+  return 0;
+#endif
+}
+
+/* Reorder the ENTRIES of the directory DIRFD, which are sorted by
+   name, by the physical offset of the first extent of their data, so
+   that the files are read in the order they lie on disk.  Entries
+   without data come first.  If the file system cannot tell where the
+   data are, order the entries by inode number instead, which is the
+   next best guess.  Equal keys keep the entries in name order, so the
+   order depends only on the on-disk layout.  */
+static void
+sort_by_extent (int dirfd, char *entries)
+{
+  idx_t count = 0;
+  char *p;
+
+  for (p = entries; *p; p += strlen (p) + 1)
+    count++;
+  if (count < 2)
+    return;
+
+  idx_t size = p - entries + 1;
+  struct extent_entry *v = xinmalloc (count, sizeof *v);
+  bool unsupported = false;
+  idx_t i = 0;
+
+  for (p = entries; *p; p += strlen (p) + 1, i++)
+    {
+      struct stat st;
+      v[i].name = p;
+      v[i].offset = v[i].ino = 0;
+      if (fstatat (dirfd, p, &st, AT_SYMLINK_NOFOLLOW) == 0)
+	{
+	  v[i].ino = st.st_ino;
+	  if (S_ISREG (st.st_mode) && 0 < st.st_size && !unsupported)
+	    v[i].offset = first_extent_offset (dirfd, p, &unsupported);
+	}
+    }
+
+  extent_by_inode = unsupported;
+  qsort (v, count, sizeof *v, compare_extent_entries);
+
+  char *sorted = xmalloc (size);
+  char *q = sorted;
+  for (i = 0; i < count; i++)
+    q = stpcpy (q, v[i].name) + 1;
+  *q = '\0';
+  memcpy (entries, sorted, size);
+  free (sorted);
+  free (v);
+}
+
+/* Return the entries of the directory stream DIR as streamsavedir
+   does, in the order given by --sort.  */
+char *
+sorted_streamsavedir (DIR *dir)
+{
+  if (savedir_sort_order != SAVEDIR_SORT_EXTENT)
+    return streamsavedir (dir, savedir_sort_order);
+
+  char *entries = streamsavedir (dir, SAVEDIR_SORT_NAME);
+  if (entries)
+    sort_by_extent (dirfd (dir), entries);
+  return entries;
+}
+
 /* Return the filenames in directory NAME, relative to the chdir_fd.
    If the directory does not exist, report error if MUST_EXIST is
    true.
@@ -1703,9 +1946,14 @@ tar_savedir (const char *name, bool must_exist)
 	return NULL;
       open_error (name);
     }
-  else if (! ((dir = fdopendir (fd))
-	      && (ret = streamsavedir (dir, savedir_sort_order))))
-    savedir_error (name);
+  else
+    {
+      struct timespec start = stats_start ();
+      if (! ((dir = fdopendir (fd))
+	     && (ret = sorted_streamsavedir (dir))))
+	savedir_error (name);
+      stats_stop (STATS_SAVEDIR, start);
+    }
 
   if (dir ? closedir (dir) < 0 : 0 <= fd && close (fd) < 0)
     savedir_error (name);
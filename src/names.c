@@ -458,79 +458,163 @@ struct argp names_argp = {
    This code should also be modified for non-UNIX systems to do something
    reasonable.  */
 
-static char *cached_uname;
-static char *cached_gname;
+/* Archives with many owners would otherwise look up the same few names
+   over and over, and each lookup may be a network round trip, so
+   every lookup result, including failures, is remembered.  Each
+   database has two tables of struct id_entry: one keyed by id, the
+   other by name.  */
 
-static uid_t cached_uid;	/* valid only if cached_uname is not empty */
-static gid_t cached_gid;	/* valid only if cached_gname is not empty */
+struct id_entry
+{
+  uintmax_t id;
+  bool found;		/* False if the lookup failed */
+  char const *name;	/* "" in a failed id lookup */
+};
 
-/* These variables are valid only if nonempty.  */
-static char *cached_no_such_uname;
-static char *cached_no_such_gname;
+struct id_cache
+{
+  Hash_table *by_id;
+  Hash_table *by_name;
+};
 
-/* These variables are valid only if nonzero.  It's not worth optimizing
-   the case for weird systems where 0 is not a valid uid or gid.  */
-static uid_t cached_no_such_uid;
-static gid_t cached_no_such_gid;
+static struct id_cache user_cache, group_cache;
 
-/* Given UID, find the corresponding UNAME.  */
-void
-uid_to_uname (uid_t uid, char **uname)
+static size_t
+id_entry_hash (void const *entry, size_t n_buckets)
 {
-  struct passwd *passwd;
+  struct id_entry const *p = entry;
+  return p->id % n_buckets;
+}
 
-  if (uid != 0 && uid == cached_no_such_uid)
+static bool
+id_entry_compare (void const *entry1, void const *entry2)
+{
+  struct id_entry const *p1 = entry1;
+  struct id_entry const *p2 = entry2;
+  return p1->id == p2->id;
+}
+
+static size_t
+name_entry_hash (void const *entry, size_t n_buckets)
+{
+  struct id_entry const *p = entry;
+  return hash_string (p->name, n_buckets);
+}
+
+static bool
+name_entry_compare (void const *entry1, void const *entry2)
+{
+  struct id_entry const *p1 = entry1;
+  struct id_entry const *p2 = entry2;
+  return streq (p1->name, p2->name);
+}
+
+/* Record in *PTAB that ID and NAME correspond to each other, or, if
+   !FOUND, that looking up the key failed.  If the table already has an
+   entry for the key, keep it: the first answer wins, as it does in the
+   system databases.  Return the entry for the key.  */
+static struct id_entry const *
+id_cache_insert (Hash_table **ptab, bool by_id,
+		 uintmax_t id, char const *name, bool found)
+{
+  /* Allocate the entry and its name in one block, so that the
+     table's free function releases both.  */
+  idx_t namesize = strlen (name) + 1;
+  struct id_entry *ent = xmalloc (sizeof *ent + namesize);
+  ent->id = id;
+  ent->found = found;
+  ent->name = memcpy (ent + 1, name, namesize);
+
+  if (!*ptab)
     {
-      *uname = xstrdup ("");
-      return;
+      *ptab = (by_id
+	       ? hash_initialize (0, NULL, id_entry_hash, id_entry_compare,
+				  free)
+	       : hash_initialize (0, NULL, name_entry_hash,
+				  name_entry_compare, free));
+      if (!*ptab)
+	xalloc_die ();
     }
 
-  if (!cached_uname || uid != cached_uid)
+  struct id_entry *res = hash_insert (*ptab, ent);
+  if (!res)
+    xalloc_die ();
+  if (res != ent)
+    free (ent);
+  return res;
+}
+
+/* Return the entry for ID in CACHE, or NULL if it has not been looked
+   up yet.  */
+static struct id_entry const *
+id_cache_lookup_id (struct id_cache *cache, uintmax_t id)
+{
+  if (!cache->by_id)
+    return NULL;
+  struct id_entry key;
+  key.id = id;
+  return hash_lookup (cache->by_id, &key);
+}
+
+/* Return the entry for NAME in CACHE, or NULL if it has not been
+   looked up yet.  */
+static struct id_entry const *
+id_cache_lookup_name (struct id_cache *cache, char const *name)
+{
+  if (!cache->by_name)
+    return NULL;
+  struct id_entry key;
+  key.name = name;
+  return hash_lookup (cache->by_name, &key);
+}
+
+/* Record in CACHE that ID and NAME correspond to each other, in both
+   directions.  */
+static void
+id_cache_add (struct id_cache *cache, uintmax_t id, char const *name)
+{
+  id_cache_insert (&cache->by_id, true, id, name, true);
+  id_cache_insert (&cache->by_name, false, id, name, true);
+}
+
+/* Given UID, find the corresponding UNAME.  */
+void
+uid_to_uname (uid_t uid, char **uname)
+{
+  struct id_entry const *ent = id_cache_lookup_id (&user_cache, uid);
+
+  if (!ent)
     {
-      passwd = getpwuid (uid);
+      struct passwd *passwd = getpwuid (uid);
       if (passwd)
 	{
-	  cached_uid = uid;
-	  assign_string (&cached_uname, passwd->pw_name);
+	  id_cache_add (&user_cache, uid, passwd->pw_name);
+	  ent = id_cache_lookup_id (&user_cache, uid);
 	}
       else
-	{
-	  cached_no_such_uid = uid;
-	  *uname = xstrdup ("");
-	  return;
-	}
+	ent = id_cache_insert (&user_cache.by_id, true, uid, "", false);
     }
-  *uname = xstrdup (cached_uname);
+  *uname = xstrdup (ent->name);
 }
 
 /* Given GID, find the corresponding GNAME.  */
 void
 gid_to_gname (gid_t gid, char **gname)
 {
-  struct group *group;
+  struct id_entry const *ent = id_cache_lookup_id (&group_cache, gid);
 
-  if (gid != 0 && gid == cached_no_such_gid)
+  if (!ent)
     {
-      *gname = xstrdup ("");
-      return;
-    }
-
-  if (!cached_gname || gid != cached_gid)
-    {
-      group = getgrgid (gid);
+      struct group *group = getgrgid (gid);
       if (group)
 	{
-	  cached_gid = gid;
-	  assign_string (&cached_gname, group->gr_name);
+	  id_cache_add (&group_cache, gid, group->gr_name);
+	  ent = id_cache_lookup_id (&group_cache, gid);
 	}
       else
-	{
-	  cached_no_such_gid = gid;
-	  *gname = xstrdup ("");
-	  return;
-	}
+	ent = id_cache_insert (&group_cache.by_id, true, gid, "", false);
     }
-  *gname = xstrdup (cached_gname);
+  *gname = xstrdup (ent->name);
 }
 
 /* Given UNAME, set the corresponding UID and return true,
@@ -538,29 +622,17 @@ gid_to_gname (gid_t gid, char **gname)
 bool
 uname_to_uid (char const *uname, uid_t *uidp)
 {
-  struct passwd *passwd;
+  struct id_entry const *ent = id_cache_lookup_name (&user_cache, uname);
 
-  if (cached_no_such_uname
-      && streq (uname, cached_no_such_uname))
-    return false;
-
-  if (! (cached_uname
-	 && uname[0] == cached_uname[0]
-	 && streq (uname, cached_uname)))
+  if (!ent)
     {
-      passwd = getpwnam (uname);
-      if (passwd)
-	{
-	  cached_uid = passwd->pw_uid;
-	  assign_string (&cached_uname, passwd->pw_name);
-	}
-      else
-	{
-	  assign_string (&cached_no_such_uname, uname);
-	  return false;
-	}
+      struct passwd *passwd = getpwnam (uname);
+      ent = id_cache_insert (&user_cache.by_name, false,
+			     passwd ? passwd->pw_uid : 0, uname, !!passwd);
     }
-  *uidp = cached_uid;
+  if (!ent->found)
+    return false;
+  *uidp = ent->id;
   return true;
 }
 
@@ -569,33 +641,41 @@ uname_to_uid (char const *uname, uid_t *uidp)
 bool
 gname_to_gid (char const *gname, gid_t *gidp)
 {
-  struct group *group;
+  struct id_entry const *ent = id_cache_lookup_name (&group_cache, gname);
 
-  if (cached_no_such_gname
-      && streq (gname, cached_no_such_gname))
-    return false;
-
-  if (! (cached_gname
-	 && gname[0] == cached_gname[0]
-	 && streq (gname, cached_gname)))
+  if (!ent)
     {
-      group = getgrnam (gname);
-      if (group)
-	{
-	  cached_gid = group->gr_gid;
-	  assign_string (&cached_gname, gname);
-	}
-      else
-	{
-	  assign_string (&cached_no_such_gname, gname);
-	  return false;
-	}
+      struct group *group = getgrnam (gname);
+      ent = id_cache_insert (&group_cache.by_name, false,
+			     group ? group->gr_gid : 0, gname, !!group);
     }
-  *gidp = cached_gid;
+  if (!ent->found)
+    return false;
+  *gidp = ent->id;
   return true;
 }
 
-
+/* Read the whole user and group databases into the caches, so that
+   later lookups need not consult them one name at a time.  Databases
+   that cannot be enumerated, as is common for network directories,
+   are still queried for names and ids missing from the caches.  */
+void
+preload_id_caches (void)
+{
+  struct passwd *passwd;
+  struct group *group;
+
+  setpwent ();
+  while ((passwd = getpwent ()))
+    id_cache_add (&user_cache, passwd->pw_uid, passwd->pw_name);
+  endpwent ();
+
+  setgrent ();
+  while ((group = getgrent ()))
+    id_cache_add (&group_cache, group->gr_gid, group->gr_name);
+  endgrent ();
+}
+
 static struct name *
 make_name (const char *file_name)
 {
@@ -604,6 +684,7 @@ make_name (const char *file_name)
     file_name = "";
   p->name = xstrdup (file_name);
   p->length = strlen (p->name);
+  stats_alloc (STATS_MEM_NAMES, sizeof *p + p->length + 1);
   return p;
 }
 
@@ -612,6 +693,7 @@ free_name (struct name *p)
 {
   if (p)
     {
+      stats_free (STATS_MEM_NAMES, sizeof *p + p->length + 1);
       free (p->name);
       free (p->caname);
       free (p);
@@ -1152,6 +1234,18 @@ name_next (bool change_dirs)
   return nelt ? nelt->v.name : NULL;
 }
 
+/* Return true if any of the file lists given with -T is to be read
+   from the standard input.  */
+bool
+name_list_reads_stdin (void)
+{
+  name_list_adjust ();
+  for (struct name_elt const *ep = name_head; ep; ep = ep->next)
+    if (ep->type == NELT_FILE && streq (ep->v.file.name, "-"))
+      return true;
+  return false;
+}
+
 static bool
 name_is_wildcard (struct name const *name)
 {
@@ -1404,6 +1498,13 @@ name_match (const char *file_name)
     }
 }
 
+/* Return true if every archive member matches the name list.  */
+bool
+name_list_selects_all (void)
+{
+  return !namelist || (!namelist->name[0] && !namelist->next);
+}
+
 /* Returns true if all names from the namelist were processed.
    P is the stat_info of the most recently processed entry.
    The decision is postponed until the next entry is read if:
@@ -1729,6 +1830,7 @@ rebase_child_list (struct name *child, struct name *parent)
       strcat (newp, child->name + old_prefix_len);
       free (child->name);
       child->name = newp;
+      stats_alloc (STATS_MEM_NAMES, size - child->length);
       child->length = size;
 
       rebase_directory (child->directory,
@@ -1773,6 +1875,8 @@ collect_and_sort_names (void)
 	}
 
       read_directory_file ();
+      if (changed_files_option)
+	read_changed_files (namelist->change_dir);
     }
 
   num_names = 0;
@@ -0,0 +1,217 @@
+/* Internal performance counters for tar.
+
+   Copyright 2026 Free Software Foundation, Inc.
+
+   This file is part of GNU tar.
+
+   GNU tar is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU tar is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <system.h>
+#include "common.h"
+
+/* Latency histograms have one bucket per power of 4 nanoseconds,
+   starting at 1 microsecond: the first bucket counts calls shorter
+   than 1us, the next one calls shorter than 4us, and so on; the last
+   bucket counts calls that took 1s or longer.  */
+enum { STATS_BUCKETS = 12 };
+
+struct stats_timer_data
+{
+  intmax_t calls;		/* Number of timed calls */
+  double total_ns;		/* Time spent in them */
+  double max_ns;		/* Longest call */
+  intmax_t hist[STATS_BUCKETS];	/* Latency histogram */
+};
+
+static struct stats_timer_data timers[STATS_TIMERS];
+
+static char const *const timer_name[STATS_TIMERS] = {
+  [STATS_FLUSH_ARCHIVE] = "flush_archive",
+  [STATS_FILE_READ] = "blocking_read",
+  [STATS_FILE_WRITE] = "blocking_write",
+  [STATS_STAT] = "fstatat",
+  [STATS_SAVEDIR] = "savedir",
+  [STATS_XATTR] = "xattr"
+};
+
+static char const *const bucket_name[STATS_BUCKETS] = {
+  "1us", "4us", "16us", "64us", "256us", "1ms",
+  "4ms", "16ms", "64ms", "256ms", "1s", "inf"
+};
+
+/* Number of archive members processed.  */
+static intmax_t members;
+
+/* Bytes allocated for each kind of data structure, now and at most.
+   Only the requested sizes are counted, not the malloc overhead.  */
+static struct
+{
+  intmax_t bytes;
+  intmax_t peak;
+} memory[STATS_MEMORY];
+
+/* Sum of the current bytes of all structures.  */
+static intmax_t memory_total;
+
+static char const *const memory_name[STATS_MEMORY] = {
+  [STATS_MEM_NAMES] = "names",
+  [STATS_MEM_DIRECTORIES] = "directories",
+  [STATS_MEM_LINKS] = "links",
+  [STATS_MEM_DELAYED] = "delayed"
+};
+
+struct timespec
+stats_now (void)
+{
+  struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0)
+    return ts;
+#endif
+  gettime (&ts);
+  return ts;
+}
+
+void
+stats_record (enum stats_timer timer, struct timespec start)
+{
+  struct timespec now = stats_now ();
+  double ns = (1e9 * (now.tv_sec - start.tv_sec)
+	       + (now.tv_nsec - start.tv_nsec));
+  struct stats_timer_data *t = &timers[timer];
+  int b;
+  double lim;
+
+  if (ns < 0)
+    ns = 0;
+  t->calls++;
+  t->total_ns += ns;
+  if (t->max_ns < ns)
+    t->max_ns = ns;
+  for (b = 0, lim = 1000; b < STATS_BUCKETS - 1 && lim <= ns; b++)
+    lim *= 4;
+  t->hist[b]++;
+}
+
+/* Account SIZE bytes newly allocated to MEM.  */
+void
+stats_alloc (enum stats_memory mem, idx_t size)
+{
+  memory[mem].bytes += size;
+  if (memory[mem].peak < memory[mem].bytes)
+    memory[mem].peak = memory[mem].bytes;
+  memory_total += size;
+}
+
+/* Account SIZE bytes of MEM as freed.  */
+void
+stats_free (enum stats_memory mem, idx_t size)
+{
+  memory[mem].bytes -= size;
+  memory_total -= size;
+}
+
+/* Return true if the structures counted by stats_alloc use more than
+   --memory-limit allows.  */
+bool
+memory_limit_reached (void)
+{
+  return memory_limit_option && memory_limit_option < memory_total;
+}
+
+void
+stats_count_member (void)
+{
+  members++;
+}
+
+/* Return the number of archive members processed so far.  */
+intmax_t
+stats_members (void)
+{
+  return members;
+}
+
+/* Print the detailed statistics to FP, in human-readable form.  */
+void
+print_detailed_stats (FILE *fp)
+{
+  double duration_ns = compute_duration_ns ();
+
+  fprintf (fp, _("Members processed: %jd"), members);
+  if (duration_ns)
+    fprintf (fp, _(" (%.1f/s)"), 1e9 * members / duration_ns);
+  fputc ('\n', fp);
+
+  for (int i = 0; i < STATS_TIMERS; i++)
+    {
+      struct stats_timer_data const *t = &timers[i];
+      if (!t->calls)
+	continue;
+      fprintf (fp, _("Time in %s: %.6f s in %jd calls (max %.6f s)\n"),
+	       timer_name[i], t->total_ns / 1e9, t->calls, t->max_ns / 1e9);
+      fprintf (fp, "  %s", _("latency:"));
+      for (int b = 0; b < STATS_BUCKETS; b++)
+	if (t->hist[b])
+	  fprintf (fp, " <%s:%jd", bucket_name[b], t->hist[b]);
+      fputc ('\n', fp);
+    }
+
+  for (int i = 0; i < STATS_MEMORY; i++)
+    if (memory[i].peak)
+      fprintf (fp, _("Peak memory in %s: %jd bytes\n"),
+	       memory_name[i], memory[i].peak);
+}
+
+/* Write the statistics as a JSON object to the file named by
+   stats_file_option, replacing its previous contents.  */
+void
+write_stats_file (void)
+{
+  FILE *fp = fopen (stats_file_option, "w");
+  if (!fp)
+    {
+      open_error (stats_file_option);
+      return;
+    }
+
+  double duration_ns = compute_duration_ns ();
+  fprintf (fp, "{\"elapsed\":%.6f,\"bytes_read\":%jd,\"bytes_written\":%.0f",
+	   duration_ns / 1e9, intmax (records_read) * record_size,
+	   total_bytes_written ());
+  fprintf (fp, ",\"members\":%jd,\"members_per_s\":%.3f,\"timers\":{",
+	   members, duration_ns ? 1e9 * members / duration_ns : 0.0);
+  for (int i = 0; i < STATS_TIMERS; i++)
+    {
+      struct stats_timer_data const *t = &timers[i];
+      fprintf (fp, "%s\"%s\":{\"calls\":%jd,\"seconds\":%.6f"
+	       ",\"max_seconds\":%.6f,\"histogram\":{",
+	       i ? "," : "", timer_name[i], t->calls, t->total_ns / 1e9,
+	       t->max_ns / 1e9);
+      for (int b = 0; b < STATS_BUCKETS; b++)
+	fprintf (fp, "%s\"<%s\":%jd", b ? "," : "", bucket_name[b],
+		 t->hist[b]);
+      fputs ("}}", fp);
+    }
+  fputs ("},\"memory\":{", fp);
+  for (int i = 0; i < STATS_MEMORY; i++)
+    fprintf (fp, "%s\"%s\":{\"bytes\":%jd,\"peak\":%jd}",
+	     i ? "," : "", memory_name[i], memory[i].bytes, memory[i].peak);
+  fputs ("}}\n", fp);
+
+  if (ferror (fp))
+    write_error (stats_file_option);
+  if (fclose (fp) < 0)
+    close_error (stats_file_option);
+}
@@ -77,6 +77,115 @@ mtioseek (bool count_files, off_t count)
   return false;
 }
 
+/* Tell the system that the file open on FD is going to be read
+   sequentially, so that it reads further ahead.  */
+void
+sys_advise_sequential (MAYBE_UNUSED int fd)
+{
+#if HAVE_POSIX_FADVISE
+  posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+/* With --drop-cache, tell the system that the LEN bytes of the file
+   open on FD at OFFSET (up to its end, if LEN is 0) are not going to
+   be used again, so that they do not push more useful data out of the
+   page cache.  Pages not yet written out cannot be dropped at once:
+   the call starts writing them, and a later call for the same range
+   drops them.  */
+void
+sys_drop_cache (MAYBE_UNUSED int fd, MAYBE_UNUSED off_t offset,
+		MAYBE_UNUSED off_t len)
+{
+#if HAVE_POSIX_FADVISE
+  if (drop_cache_option)
+    posix_fadvise (fd, offset, len, POSIX_FADV_DONTNEED);
+#endif
+}
+
+/* Number of files written whose data are dropped from the page cache
+   a second time, once that many more files have been written.  */
+enum { DROP_CACHE_DELAY = 16 };
+
+/* Duplicates of the descriptors of the last files written, and the
+   number of files passed to sys_drop_written_cache so far.  */
+static int drop_cache_fd[DROP_CACHE_DELAY];
+static idx_t drop_cache_files;
+
+/* With --drop-cache, drop the data of the file just written on FD from
+   the page cache.  This only starts writing them out, so keep a
+   duplicate of FD and drop them again DROP_CACHE_DELAY files later,
+   when they have most likely reached the disk.  */
+void
+sys_drop_written_cache (MAYBE_UNUSED int fd)
+{
+#if HAVE_POSIX_FADVISE
+  if (drop_cache_option)
+    {
+      int slot = drop_cache_files % DROP_CACHE_DELAY;
+      if (DROP_CACHE_DELAY <= drop_cache_files && 0 <= drop_cache_fd[slot])
+	{
+	  posix_fadvise (drop_cache_fd[slot], 0, 0, POSIX_FADV_DONTNEED);
+	  close (drop_cache_fd[slot]);
+	}
+      posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+      drop_cache_fd[slot] = fcntl (fd, F_DUPFD_CLOEXEC, 0);
+      drop_cache_files++;
+    }
+#endif
+}
+
+/* Drop the data of the files passed to sys_drop_written_cache that
+   have not been dropped a second time yet.  */
+void
+sys_drop_written_cache_finish (void)
+{
+#if HAVE_POSIX_FADVISE
+  for (idx_t i = 0; i < min (drop_cache_files, DROP_CACHE_DELAY); i++)
+    if (0 <= drop_cache_fd[i])
+      {
+	posix_fadvise (drop_cache_fd[i], 0, 0, POSIX_FADV_DONTNEED);
+	close (drop_cache_fd[i]);
+      }
+  drop_cache_files = 0;
+#endif
+}
+
+/* Ask the system to start reading the first SIZE bytes of the file
+   NAME in the directory DIRFD, without waiting for them.  Failures
+   are ignored: the file is opened again when it is archived, and any
+   problem is reported then.  */
+void
+sys_prefetch_file (MAYBE_UNUSED int dirfd, MAYBE_UNUSED char const *name,
+		   MAYBE_UNUSED off_t size)
+{
+#if HAVE_POSIX_FADVISE
+  int fd = openat (dirfd, name, open_read_flags);
+  if (0 <= fd)
+    {
+      posix_fadvise (fd, 0, size, POSIX_FADV_WILLNEED);
+      close (fd);
+    }
+#endif
+}
+
+/* Turn direct I/O, which bypasses the page cache, on or off for the
+   file open on FD.  Return true if successful, false (setting errno)
+   otherwise.  */
+bool
+sys_set_direct_io (int fd, bool on)
+{
+  if (!O_DIRECT)
+    {
+      errno = ENOTSUP;
+      return false;
+    }
+  int flags = fcntl (fd, F_GETFL);
+  return (0 <= flags
+	  && 0 <= fcntl (fd, F_SETFL,
+			 on ? flags | O_DIRECT : flags & ~O_DIRECT));
+}
+
 #if !HAVE_WAITPID /* MingW, MSVC 14.  */
 
 bool
@@ -105,6 +214,11 @@ sys_wait_for_child (pid_t child_pid, bool eof)
 {
 }
 
+void
+sys_wait_for_shard (pid_t pid)
+{
+}
+
 void
 sys_spawn_shell (void)
 {
@@ -153,6 +267,13 @@ sys_child_open_for_uncompress (void)
   paxfatal (0, _("Cannot use compressed or remote archives"));
 }
 
+/* Reading ahead needs a child process; just read the archive directly.  */
+pid_t
+sys_child_open_for_read_ahead (idx_t size)
+{
+  return 0;
+}
+
 bool
 sys_exec_setmtime_script (const char *script_name,
 			  int dirfd,
@@ -235,6 +356,27 @@ sys_wait_for_child (pid_t child_pid, bool eof)
     }
 }
 
+/* Wait for the process PID that creates or extracts one of several
+   archives, or for any child process if PID is -1.  It reports its
+   own errors; just merge its exit status into ours.  */
+void
+sys_wait_for_shard (pid_t pid)
+{
+  int wait_status;
+
+  while (waitpid (pid, &wait_status, 0) < 0)
+    if (errno != EINTR)
+      {
+	waitpid_error (program_name);
+	return;
+      }
+
+  if (WIFSIGNALED (wait_status))
+    paxerror (0, _("Child died with signal %d"), WTERMSIG (wait_status));
+  else if (WEXITSTATUS (wait_status) != 0)
+    set_exit_status (WEXITSTATUS (wait_status));
+}
+
 void
 sys_spawn_shell (void)
 {
@@ -639,6 +781,61 @@ sys_child_open_for_uncompress (void)
   wait_for_grandchild (grandchild_pid);
 }
 
+/* Hand ARCHIVE, which is open for reading, over to a child process
+   that reads it ahead of us, and set ARCHIVE to a pipe that delivers
+   the data.  The child may get up to SIZE bytes ahead, if the system
+   lets the pipe hold that much.  */
+pid_t
+sys_child_open_for_read_ahead (idx_t size)
+{
+  int parent_pipe[2];
+  pid_t child_pid;
+
+  xpipe (parent_pipe);
+#ifdef F_SETPIPE_SZ
+  /* Failure is harmless: the pipe just keeps its default capacity.  */
+  fcntl (parent_pipe[PWRITE], F_SETPIPE_SZ, (int) min (size, INT_MAX));
+#endif
+  /* The child exits through exit, so it must not inherit any pending
+     output, e.g. the listing of an earlier archive.  */
+  fflush (NULL);
+  child_pid = xfork ();
+
+  if (child_pid > 0)
+    {
+      /* The parent tar is still here!  Just clean up.  */
+
+      xclose (archive);
+      archive = parent_pipe[PREAD];
+      xclose (parent_pipe[PWRITE]);
+      return child_pid;
+    }
+
+  /* The newborn child tar is here!  Copy the rest of the archive into
+     the pipe.  */
+
+  set_program_name (_("tar (child)"));
+  signal (SIGPIPE, SIG_DFL);
+  xclose (parent_pipe[PREAD]);
+
+  while (true)
+    {
+      clear_read_error_count ();
+
+      ptrdiff_t n;
+      while ((n = rmtread (archive, charptr (record_start), record_size)) < 0)
+	archive_read_error ();
+      if (n == 0)
+	break;
+
+      if (full_write (parent_pipe[PWRITE], charptr (record_start), n) != n)
+	paxfatal (errno, _("Cannot write to read-ahead pipe"));
+    }
+
+  xclose (parent_pipe[PWRITE]);
+  exit (exit_status);
+}
+
 
 
 static void
@@ -36,6 +36,7 @@ enum subcommand subcommand_option;
 enum archive_format archive_format;
 idx_t blocking_factor;
 idx_t record_size;
+bool auto_record_size_option;
 bool absolute_names_option;
 bool utc_option;
 bool full_time_option;
@@ -61,10 +62,15 @@ enum old_files old_files_option;
 bool keep_directory_symlink_option;
 const char *listed_incremental_option;
 signed char incremental_level;
+char const *changed_files_option;
+bool snapshot_journal_option;
 bool check_device_option;
 struct mode_change *mode_option;
 mode_t initial_umask;
 bool multi_volume_option;
+bool separate_archives_option;
+idx_t jobs_option = 1;
+char const *manifest_option;
 struct timespec newer_mtime_option;
 enum set_mtime_option_mode set_mtime_option;
 struct timespec mtime_option;
@@ -78,6 +84,10 @@ char const *owner_name_option;
 uid_t owner_option;
 bool recursive_unlink_option;
 bool read_full_records_option;
+idx_t read_ahead_option;
+bool drop_cache_option;
+idx_t prefetch_option;
+bool direct_io_option;
 bool remove_files_option;
 const char *rsh_command_option;
 bool same_order_option;
@@ -96,6 +106,10 @@ bool starting_file_option;
 tarlong tape_length_option;
 bool to_stdout_option;
 bool totals_option;
+bool detailed_totals_option;
+char const *stats_file_option;
+bool stats_option;
+idx_t memory_limit_option;
 bool touch_option;
 char *to_command_option;
 bool ignore_command_error_option;
@@ -356,6 +370,7 @@ enum
   ACLS_OPTION = CHAR_MAX + 1,
   ATIME_PRESERVE_OPTION,
   BACKUP_OPTION,
+  CHANGED_FILES_OPTION,
   CHECK_DEVICE_OPTION,
   CHECKPOINT_OPTION,
   CHECKPOINT_ACTION_OPTION,
@@ -363,6 +378,8 @@ enum
   DELAY_DIRECTORY_RESTORE_OPTION,
   HARD_DEREFERENCE_OPTION,
   DELETE_OPTION,
+  DIRECT_IO_OPTION,
+  DROP_CACHE_OPTION,
   FORCE_LOCAL_OPTION,
   FULL_TIME_OPTION,
   GROUP_OPTION,
@@ -370,12 +387,15 @@ enum
   IGNORE_COMMAND_ERROR_OPTION,
   IGNORE_FAILED_READ_OPTION,
   INDEX_FILE_OPTION,
+  JOBS_OPTION,
   KEEP_DIRECTORY_SYMLINK_OPTION,
   KEEP_NEWER_FILES_OPTION,
   LEVEL_OPTION,
   LZIP_OPTION,
   LZMA_OPTION,
   LZOP_OPTION,
+  MANIFEST_OPTION,
+  MEMORY_LIMIT_OPTION,
   MODE_OPTION,
   MTIME_OPTION,
   NEWER_MTIME_OPTION,
@@ -400,10 +420,13 @@ enum
   OVERWRITE_OPTION,
   OWNER_OPTION,
   OWNER_MAP_OPTION,
+  PREFETCH_OPTION,
+  PRELOAD_OWNERS_OPTION,
   PAX_OPTION,
   POSIX_OPTION,
   QUOTE_CHARS_OPTION,
   QUOTING_STYLE_OPTION,
+  READ_AHEAD_OPTION,
   RECORD_SIZE_OPTION,
   RECURSIVE_UNLINK_OPTION,
   REMOVE_FILES_OPTION,
@@ -412,14 +435,17 @@ enum
   RSH_COMMAND_OPTION,
   SAME_OWNER_OPTION,
   SELINUX_CONTEXT_OPTION,
+  SEPARATE_ARCHIVES_OPTION,
   SHOW_DEFAULTS_OPTION,
   SHOW_OMITTED_DIRS_OPTION,
   SHOW_SNAPSHOT_FIELD_RANGES_OPTION,
   SHOW_TRANSFORMED_NAMES_OPTION,
   SKIP_OLD_FILES_OPTION,
+  SNAPSHOT_JOURNAL_OPTION,
   SORT_OPTION,
   HOLE_DETECTION_OPTION,
   SPARSE_VERSION_OPTION,
+  STATS_FILE_OPTION,
   STRIP_COMPONENTS_OPTION,
   SUFFIX_OPTION,
   TEST_LABEL_OPTION,
@@ -569,6 +595,12 @@ static struct argp_option options[] = {
    N_("handle new GNU-format incremental backup"), GRID_MODIFIER },
   {"level", LEVEL_OPTION, N_("NUMBER"), 0,
    N_("dump level for created listed-incremental archive"), GRID_MODIFIER },
+  {"changed-files", CHANGED_FILES_OPTION, N_("FILE"), 0,
+   N_("with --listed-incremental, read only the directories of the files"
+      " listed in FILE as changed since the last dump"), GRID_MODIFIER },
+  {"snapshot-journal", SNAPSHOT_JOURNAL_OPTION, NULL, 0,
+   N_("with --listed-incremental, append the changes to the snapshot file"
+      " instead of rewriting it"), GRID_MODIFIER },
   {"ignore-failed-read", IGNORE_FAILED_READ_OPTION, NULL, 0,
    N_("do not exit with nonzero on unreadable files"), GRID_MODIFIER },
   {"occurrence", OCCURRENCE_OPTION, N_("NUMBER"), OPTION_ARG_OPTIONAL,
@@ -668,6 +700,8 @@ static struct argp_option options[] = {
    N_("extract files as yourself (default for ordinary users)"), GRID_FATTR },
   {"numeric-owner", NUMERIC_OWNER_OPTION, NULL, 0,
    N_("always use numbers for user/group names"), GRID_FATTR },
+  {"preload-owners", PRELOAD_OWNERS_OPTION, NULL, 0,
+   N_("read the user and group databases once, at startup"), GRID_FATTR },
   {"preserve-permissions", 'p', NULL, 0,
    N_("extract information about file permissions (default for superuser)"),
    GRID_FATTR },
@@ -685,9 +719,9 @@ static struct argp_option options[] = {
    N_("cancel the effect of --delay-directory-restore option"), GRID_FATTR },
   {"sort", SORT_OPTION, N_("ORDER"), 0,
 #if D_INO_IN_DIRENT
-   N_("directory sorting order: none (default), name or inode")
+   N_("directory sorting order: none (default), name, inode or extent")
 #else
-   N_("directory sorting order: none (default) or name")
+   N_("directory sorting order: none (default), name or extent")
 #endif
      , GRID_FATTR },
 
@@ -755,18 +789,43 @@ static struct argp_option options[] = {
   {"volno-file", VOLNO_FILE_OPTION, N_("FILE"), 0,
    N_("use/update the volume number in FILE"),
    GRID_DEVICE },
+  {"separate-archives", SEPARATE_ARCHIVES_OPTION, NULL, 0,
+   N_("list/extract/compare each -f ARCHIVE in turn, as separate archives,"
+      " or create them all at once, sharing out the FILEs among them"),
+   GRID_DEVICE },
+  {"manifest", MANIFEST_OPTION, N_("FILE"), 0,
+   N_("with --separate-archives, record in FILE which archive each FILE"
+      " went to"),
+   GRID_DEVICE },
+  {"jobs", JOBS_OPTION, N_("N"), 0,
+   N_("with --separate-archives, extract up to N archives of a chain of"
+      " incremental archives at once"),
+   GRID_DEVICE },
 
   {NULL, 0, NULL, 0,
    N_("Device blocking:"), GRH_BLOCKING },
 
   {"blocking-factor", 'b', N_("BLOCKS"), 0,
-   N_("BLOCKS x 512 bytes per record"), GRID_BLOCKING },
+   N_("BLOCKS x 512 bytes per record, or 'auto'"), GRID_BLOCKING },
   {"record-size", RECORD_SIZE_OPTION, N_("NUMBER"), 0,
-   N_("NUMBER of bytes per record, multiple of 512"), GRID_BLOCKING },
+   N_("NUMBER of bytes per record, multiple of 512, or 'auto' to"
+      " choose the I/O size from the archive type"), GRID_BLOCKING },
   {"ignore-zeros", 'i', NULL, 0,
    N_("ignore zeroed blocks in archive (means EOF)"), GRID_BLOCKING },
   {"read-full-records", 'B', NULL, 0,
    N_("reblock as we read (for 4.2BSD pipes)"), GRID_BLOCKING },
+  {"read-ahead", READ_AHEAD_OPTION, N_("SIZE"), OPTION_ARG_OPTIONAL,
+   N_("read the archive in a separate process, up to SIZE bytes"
+      " (default 1M) ahead"), GRID_BLOCKING },
+  {"direct-io", DIRECT_IO_OPTION, NULL, 0,
+   N_("bypass the page cache when the archive is a regular file"),
+   GRID_BLOCKING },
+  {"drop-cache", DROP_CACHE_OPTION, NULL, 0,
+   N_("drop file and archive data from the page cache once processed"),
+   GRID_BLOCKING },
+  {"prefetch", PREFETCH_OPTION, N_("COUNT"), OPTION_ARG_OPTIONAL,
+   N_("when creating, start reading the next COUNT (default 16) files"
+      " of a directory ahead of time"), GRID_BLOCKING },
 
   {NULL, 0, NULL, 0,
    N_("Archive format selection:"), GRH_FORMAT },
@@ -873,7 +932,12 @@ static struct argp_option options[] = {
    N_("print total bytes after processing the archive; "
       "with an argument - print total bytes when this SIGNAL is delivered; "
       "Allowed signals are: SIGHUP, SIGQUIT, SIGINT, SIGUSR1 and SIGUSR2; "
-      "the names without SIG prefix are also accepted"), GRID_INFORMATIVE },
+      "the names without SIG prefix are also accepted; "
+      "with the argument 'detailed', also print member counts "
+      "and time spent in I/O"), GRID_INFORMATIVE },
+  {"stats-file", STATS_FILE_OPTION, N_("FILE"), 0,
+   N_("write performance statistics to FILE in JSON format"),
+   GRID_INFORMATIVE },
   {"utc", UTC_OPTION, NULL, 0,
    N_("print file modification times in UTC"), GRID_INFORMATIVE },
   {"full-time", FULL_TIME_OPTION, NULL, 0,
@@ -915,6 +979,11 @@ static struct argp_option options[] = {
   {NULL, 0, NULL, 0,
    N_("Other options:"), GRH_OTHER },
 
+  {"memory-limit", MEMORY_LIMIT_OPTION, N_("SIZE"), 0,
+   N_("once the file tables take more than SIZE bytes, stop building"
+      " those that are optional, such as the hard link table; this does"
+      " not bound tar's memory use"),
+   GRID_OTHER },
   {"restrict", RESTRICT_OPTION, NULL, 0,
    N_("disable use of some potentially harmful options"), -1 },
 
@@ -1071,6 +1140,8 @@ sigstat (int signo)
 {
   compute_duration_ns ();
   print_total_stats ();
+  if (stats_file_option)
+    write_stats_file ();
 #ifndef HAVE_SIGACTION
   signal (signo, sigstat);
 #endif
@@ -1361,15 +1432,17 @@ static char const *const sort_mode_arg[] = {
 #if D_INO_IN_DIRENT
   "inode",
 #endif
+  "extent",
   NULL
 };
 
-static enum savedir_option const sort_mode_flag[] = {
+static int const sort_mode_flag[] = {
     SAVEDIR_SORT_NONE,
     SAVEDIR_SORT_NAME,
 #if D_INO_IN_DIRENT
-    SAVEDIR_SORT_INODE
+    SAVEDIR_SORT_INODE,
 #endif
+    SAVEDIR_SORT_EXTENT
 };
 
 ARGMATCH_VERIFY (sort_mode_arg, sort_mode_flag);
@@ -1453,17 +1526,21 @@ parse_opt (int key, char *arg, struct argp_state *state)
       break;
 
     case 'b':
-      {
-	bool overflow;
-	char *end;
-	blocking_factor = stoint (arg, &end, &overflow, 0,
-				  (min (IDX_MAX, min (SSIZE_MAX, SIZE_MAX))
-				   / BLOCKSIZE));
-	if ((end == arg) | *end | overflow | !blocking_factor)
-	  paxusage ("%s: %s", quotearg_colon (arg),
-		    _("Invalid blocking factor"));
-	record_size = blocking_factor * BLOCKSIZE;
-      }
+      if (streq (arg, "auto"))
+	auto_record_size_option = true;
+      else
+	{
+	  bool overflow;
+	  char *end;
+	  blocking_factor = stoint (arg, &end, &overflow, 0,
+				    (min (IDX_MAX, min (SSIZE_MAX, SIZE_MAX))
+				     / BLOCKSIZE));
+	  if ((end == arg) | *end | overflow | !blocking_factor)
+	    paxusage ("%s: %s", quotearg_colon (arg),
+		      _("Invalid blocking factor"));
+	  record_size = blocking_factor * BLOCKSIZE;
+	  auto_record_size_option = false;
+	}
       break;
 
     case 'B':
@@ -1663,6 +1740,14 @@ parse_opt (int key, char *arg, struct argp_state *state)
       }
       break;
 
+    case CHANGED_FILES_OPTION:
+      changed_files_option = arg;
+      break;
+
+    case SNAPSHOT_JOURNAL_OPTION:
+      snapshot_journal_option = true;
+      break;
+
     case LEVEL_OPTION:
       {
 	char *end;
@@ -1916,6 +2001,14 @@ parse_opt (int key, char *arg, struct argp_state *state)
       set_subcommand_option (DELETE_SUBCOMMAND);
       break;
 
+    case DIRECT_IO_OPTION:
+      direct_io_option = true;
+      break;
+
+    case DROP_CACHE_OPTION:
+      drop_cache_option = true;
+      break;
+
     case FORCE_LOCAL_OPTION:
       force_local_option = true;
       break;
@@ -2032,6 +2125,40 @@ parse_opt (int key, char *arg, struct argp_state *state)
       owner_map_read (arg);
       break;
 
+    case PRELOAD_OWNERS_OPTION:
+      preload_id_caches ();
+      break;
+
+    case SEPARATE_ARCHIVES_OPTION:
+      separate_archives_option = true;
+      break;
+
+    case MANIFEST_OPTION:
+      manifest_option = arg;
+      break;
+
+    case JOBS_OPTION:
+      {
+	bool overflow;
+	char *end;
+	jobs_option = stoint (arg, &end, &overflow, 0, IDX_MAX);
+	if ((end == arg) | *end | overflow | !jobs_option)
+	  paxusage ("%s: %s", quotearg_colon (arg),
+		    _("Invalid number of jobs"));
+      }
+      break;
+
+    case MEMORY_LIMIT_OPTION:
+      {
+	uintmax_t u;
+
+	if (! (xstrtoumax (arg, NULL, 10, &u, TAR_SIZE_SUFFIXES) == LONGINT_OK
+	       && !ckd_add (&memory_limit_option, u, 0)
+	       && 0 < memory_limit_option))
+	  paxusage ("%s: %s", quotearg_colon (arg), _("Invalid memory limit"));
+      }
+      break;
+
     case QUOTE_CHARS_OPTION:
       for (;*arg; arg++)
 	set_char_quoting (NULL, *arg, 1);
@@ -2054,18 +2181,51 @@ parse_opt (int key, char *arg, struct argp_state *state)
       set_archive_format ("posix");
       break;
 
-    case RECORD_SIZE_OPTION:
-      {
-	uintmax_t u;
+    case READ_AHEAD_OPTION:
+      if (!arg)
+	read_ahead_option = 1024 * 1024;
+      else
+	{
+	  uintmax_t u;
 
-	if (! (xstrtoumax (arg, NULL, 10, &u, TAR_SIZE_SUFFIXES) == LONGINT_OK
-	       && !ckd_add (&record_size, u, 0)
-	       && record_size <= min (SSIZE_MAX, SIZE_MAX)))
-	  paxusage ("%s: %s", quotearg_colon (arg), _("Invalid record size"));
-	if (record_size % BLOCKSIZE != 0)
-	  paxusage (_("Record size must be a multiple of %d."), BLOCKSIZE);
-	blocking_factor = record_size >> LG_BLOCKSIZE;
-      }
+	  if (! (xstrtoumax (arg, NULL, 10, &u, TAR_SIZE_SUFFIXES) == LONGINT_OK
+		 && !ckd_add (&read_ahead_option, u, 0)
+		 && 0 < read_ahead_option))
+	    paxusage ("%s: %s", quotearg_colon (arg),
+		      _("Invalid read-ahead size"));
+	}
+      break;
+
+    case PREFETCH_OPTION:
+      if (!arg)
+	prefetch_option = 16;
+      else
+	{
+	  uintmax_t u;
+
+	  if (! (xstrtoumax (arg, NULL, 10, &u, "") == LONGINT_OK
+		 && !ckd_add (&prefetch_option, u, 0)))
+	    paxusage ("%s: %s", quotearg_colon (arg),
+		      _("Invalid prefetch count"));
+	}
+      break;
+
+    case RECORD_SIZE_OPTION:
+      if (streq (arg, "auto"))
+	auto_record_size_option = true;
+      else
+	{
+	  uintmax_t u;
+
+	  if (! (xstrtoumax (arg, NULL, 10, &u, TAR_SIZE_SUFFIXES) == LONGINT_OK
+		 && !ckd_add (&record_size, u, 0)
+		 && record_size <= min (SSIZE_MAX, SIZE_MAX)))
+	    paxusage ("%s: %s", quotearg_colon (arg), _("Invalid record size"));
+	  if (record_size % BLOCKSIZE != 0)
+	    paxusage (_("Record size must be a multiple of %d."), BLOCKSIZE);
+	  blocking_factor = record_size >> LG_BLOCKSIZE;
+	  auto_record_size_option = false;
+	}
       break;
 
     case RECURSIVE_UNLINK_OPTION:
@@ -2137,12 +2297,22 @@ parse_opt (int key, char *arg, struct argp_state *state)
       break;
 
     case TOTALS_OPTION:
-      if (arg)
+      if (arg && streq (arg, "detailed"))
+	{
+	  totals_option = detailed_totals_option = true;
+	  stats_option = true;
+	}
+      else if (arg)
 	set_stat_signal (arg);
       else
 	totals_option = true;
       break;
 
+    case STATS_FILE_OPTION:
+      stats_file_option = arg;
+      stats_option = true;
+      break;
+
     case 'I':
       set_use_compress_program_option (arg, args->loc);
       break;
@@ -2529,9 +2699,52 @@ decode_options (int argc, char **argv)
       archive_names = 1;
     }
 
-  /* Allow multiple archives only with '-M'.  */
+  if (separate_archives_option)
+    {
+      if (! (is_subcommand_class (SUBCL_READ)
+	     || subcommand_option == CREATE_SUBCOMMAND))
+	option_conflict_error ("--separate-archives",
+			       subcommand_string (subcommand_option));
+      if (multi_volume_option)
+	option_conflict_error ("--separate-archives", "--multi-volume");
+      if (same_order_option)
+	option_conflict_error ("--separate-archives", "--same-order");
+      if (subcommand_option == CREATE_SUBCOMMAND)
+	{
+	  /* Each archive is written by a process of its own.  */
+	  if (incremental_option)
+	    option_conflict_error ("--separate-archives",
+				   (listed_incremental_option
+				    ? "--listed-incremental"
+				    : "--incremental"));
+	  if (archive_names > 1)
+	    for (idx_t i = 0; i < archive_names; i++)
+	      if (streq (archive_name_array[i], "-"))
+		paxusage (_("Cannot write several archives"
+			    " to standard output"));
+	  if (name_list_reads_stdin ())
+	    paxusage (_("Cannot read file names from standard input"
+			" when creating several archives"));
+	}
+    }
+  if (changed_files_option && ! listed_incremental_option)
+    paxusage (_("--changed-files requires --listed-incremental"));
+  if (snapshot_journal_option && ! listed_incremental_option)
+    paxusage (_("--snapshot-journal requires --listed-incremental"));
+
+  if (manifest_option
+      && ! (separate_archives_option
+	    && subcommand_option == CREATE_SUBCOMMAND))
+    paxusage (_("--manifest requires --separate-archives and --create"));
 
-  if (archive_names > 1 && !multi_volume_option)
+  if (1 < jobs_option
+      && ! (separate_archives_option
+	    && subcommand_option == EXTRACT_SUBCOMMAND))
+    paxusage (_("--jobs requires --separate-archives and --extract"));
+
+  /* Allow multiple archives only with '-M' or --separate-archives.  */
+
+  if (archive_names > 1 && !multi_volume_option && !separate_archives_option)
     paxusage (_("Multiple archive files require '-M' option"));
 
   if (listed_incremental_option
@@ -2934,6 +3147,9 @@ main (int argc, char **argv)
   if (totals_option)
     print_total_stats ();
 
+  if (stats_file_option)
+    write_stats_file ();
+
   if (check_links_option)
     check_links ();
 
@@ -2982,15 +3198,20 @@ void
 tar_stat_destroy (struct tar_stat_info *st)
 {
   tar_stat_close (st);
-  xattr_map_free (&st->xattr_map);
+  if (st->arena)
+    free (st->xattr_map.xm_map);
+  else
+    {
+      xattr_map_free (&st->xattr_map);
+      free (st->uname);
+      free (st->gname);
+      free (st->cntx_name);
+      free (st->acls_a_ptr);
+      free (st->acls_d_ptr);
+    }
   free (st->orig_file_name);
   free (st->file_name);
   free (st->link_name);
-  free (st->uname);
-  free (st->gname);
-  free (st->cntx_name);
-  free (st->acls_a_ptr);
-  free (st->acls_d_ptr);
   free (st->sparse_map);
   free (st->dumpdir);
   xheader_destroy (&st->xhdr);
@@ -2998,6 +3219,30 @@ tar_stat_destroy (struct tar_stat_info *st)
   memset (st, 0, sizeof (*st));
 }
 
+/* Return a copy of the first N bytes of P, followed by a null byte,
+   to be stored in one of the member strings of ST that may live in
+   its arena (see struct tar_stat_info).  */
+char *
+tar_stat_strndup (struct tar_stat_info *st, char const *p, idx_t n)
+{
+  char *s = st->arena ? obstack_alloc (st->arena, n + 1) : ximalloc (n + 1);
+  memcpy (s, p, n);
+  s[n] = '\0';
+  return s;
+}
+
+/* Set the member string *PSTR of ST to a copy of VALUE, which is at
+   most N bytes long, or to null if VALUE is null.  Like
+   assign_string_n, but for strings that may live in ST's arena.  */
+void
+tar_stat_assign_n (struct tar_stat_info *st, char **pstr,
+		   char const *value, idx_t n)
+{
+  if (!st->arena)
+    free (*pstr);
+  *pstr = value ? tar_stat_strndup (st, value, strnlen (value, n)) : NULL;
+}
+
 /* Same as timespec_cmp, but ignore nanoseconds if current archive
    format does not provide sufficient resolution.  */
 int
@@ -286,6 +286,7 @@ struct xheader
   idx_t size;
   char *buffer;
   idx_t string_length;
+  bool borrowed;		/* BUFFER points into the archive record */
 };
 
 /* Information about xattrs for a file.  */
@@ -385,6 +386,12 @@ struct tar_stat_info
 
   /* Exclusion list */
   struct exclist *exclude_list;
+
+  /* If not null, uname, gname, cntx_name, acls_a_ptr, acls_d_ptr and
+     the keys and values of xattr_map are allocated from this obstack
+     rather than by malloc, and are released all at once by its owner.
+     See tar_stat_strndup.  */
+  struct obstack *arena;
 };
 
 union block
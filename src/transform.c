@@ -16,6 +16,7 @@
 
 #include <system.h>
 #include <regex.h>
+#include <c-ctype.h>
 #include <mcel.h>
 #include <quotearg.h>
 #include "common.h"
@@ -58,6 +59,16 @@ struct replace_segm
   } v;
 };
 
+enum literal_type
+  {
+    literal_none,     /* Nothing known about the regular expression */
+    literal_head,     /* Anchored at start, begins with the literal */
+    literal_start,    /* The literal, anchored at start */
+    literal_end,      /* The literal, anchored at end */
+    literal_name,     /* The literal, anchored at both ends */
+    literal_anywhere  /* The literal, not anchored */
+  };
+
 struct transform
 {
   struct transform *next;
@@ -65,6 +76,11 @@ struct transform
   int flags;
   idx_t match_number;
   regex_t regex;
+  regmatch_t *rmp;  /* Room for the matches of REGEX */
+  /* Literal text of the regular expression, see analyze_regex */
+  enum literal_type literal_type;
+  char *literal;
+  idx_t literal_len;
   /* Compiled replacement expression */
   struct replace_segm *repl_head, *repl_tail;
   idx_t segm_count; /* Number of elements in the above list */
@@ -178,6 +194,74 @@ add_case_ctl_segment (struct transform *tf, enum case_ctl_type ctl)
   segm->v.ctl = ctl;
 }
 
+/* Find out how much of the regular expression STR, compiled with
+   CFLAGS into TF, is a literal string, and record it in TF.  If STR is
+   entirely literal, names are then matched against it without running
+   the regex matcher; if it is anchored at the start and begins with a
+   literal, names not beginning with that are rejected without running
+   it.  Only ASCII characters are taken as literal, so that comparing bytes
+   finds the same matches as the matcher does in any locale.  */
+static void
+analyze_regex (struct transform *tf, char const *str, int cflags)
+{
+  bool extended = (cflags & REG_EXTENDED) != 0;
+  char const *special = extended ? ".[]*^$+?(){}|" : ".[]*^$";
+  char const *quotable = (extended ? ".[]*^$\\/,:;@=#%!~-+?(){}|"
+			  : ".[]*^$\\/,:;@=#%!~-");
+  char const *quantifiers = extended ? "*+?{" : "*";
+  bool anchored = str[0] == '^';
+  char const *p;
+  idx_t len = 0;
+
+  /* Case-insensitive matching and alternatives have no fixed text.  */
+  if ((cflags & REG_ICASE)
+      || strstr (str, extended ? "|" : "\\|"))
+    return;
+
+  tf->literal = xmalloc (strlen (str) + 1);
+  for (p = str + anchored; *p; p++)
+    {
+      char c = *p;
+      if (c == '\\')
+	{
+	  if (! (p[1] && strchr (quotable, p[1])))
+	    {
+	      /* GNU extensions: \+ and \? are quantifiers in a BRE, and
+		 \{ opens an interval.  */
+	      if (!extended && p[1] && strchr ("+?{", p[1]))
+		len -= 0 < len;
+	      break;
+	    }
+	  c = *++p;
+	}
+      else if (strchr (special, c) || !c_isascii (c))
+	{
+	  /* The last character is not literal if it is quantified.  */
+	  if (strchr (quantifiers, c))
+	    len -= 0 < len;
+	  break;
+	}
+      tf->literal[len++] = c;
+    }
+  tf->literal[len] = '\0';
+  tf->literal_len = len;
+
+  if (!*p)
+    tf->literal_type = anchored ? literal_start
+			: len ? literal_anywhere : literal_none;
+  else if (*p == '$' && !p[1])
+    tf->literal_type = anchored ? literal_name
+			: len ? literal_end : literal_none;
+  else
+    tf->literal_type = anchored && len ? literal_head : literal_none;
+
+  if (tf->literal_type == literal_none)
+    {
+      free (tf->literal);
+      tf->literal = NULL;
+    }
+}
+
 static const char *
 parse_transform_expr (const char *expr)
 {
@@ -279,6 +363,8 @@ parse_transform_expr (const char *expr)
   if (str[0] == '^' || (i > 2 && str[i - 3] == '$'))
     tf->transform_type = transform_first;
 
+  tf->rmp = xinmalloc (tf->regex.re_nsub + 1, sizeof *tf->rmp);
+  analyze_regex (tf, str, cflags);
   free (str);
 
   /* Extract and compile replacement expr */
@@ -457,22 +543,92 @@ run_case_conv (enum case_ctl_type case_ctl, char *ptr, idx_t size)
   obstack_grow (&stk, p, plim - p);
 }
 
+/* Return true if P, which points into the string S, is at the start of
+   a character.  Only locales where bytes of a multibyte character can
+   look like ASCII need the scan.  */
+static bool
+char_boundary (char const *s, char const *p)
+{
+  if (MB_CUR_MAX == 1)
+    return true;
+  char const *lim = p + strlen (p);
+  while (s < p)
+    s += mcel_scan (s, lim).len;
+  return s == p;
+}
+
+/* Match INPUT against the regular expression of TF, like regexec.  Use
+   the literal text of the expression instead, if it is enough.  */
+static bool
+transform_exec (struct transform *tf, char const *input)
+{
+  char const *lit = tf->literal;
+  idx_t len = tf->literal_len;
+  regmatch_t *rmp = tf->rmp;
+  char const *p;
+
+  switch (tf->literal_type)
+    {
+    case literal_none:
+      break;
+
+    case literal_head:
+      if (strncmp (input, lit, len) != 0)
+	return false;
+      break;
+
+    case literal_start:
+      if (strncmp (input, lit, len) != 0)
+	return false;
+      rmp[0].rm_so = 0;
+      rmp[0].rm_eo = len;
+      return true;
+
+    case literal_end:
+      {
+	idx_t n = strlen (input);
+	if (n < len || !memeq (input + n - len, lit, len)
+	    || !char_boundary (input, input + n - len))
+	  return false;
+	rmp[0].rm_so = n - len;
+	rmp[0].rm_eo = n;
+	return true;
+      }
+
+    case literal_name:
+      if (!streq (input, lit))
+	return false;
+      rmp[0].rm_so = 0;
+      rmp[0].rm_eo = len;
+      return true;
+
+    case literal_anywhere:
+      for (p = input; (p = strstr (p, lit)); p++)
+	if (char_boundary (input, p))
+	  {
+	    rmp[0].rm_so = p - input;
+	    rmp[0].rm_eo = p - input + len;
+	    return true;
+	  }
+      return false;
+    }
+
+  return regexec (&tf->regex, input, tf->regex.re_nsub + 1, rmp, 0) == 0;
+}
+
 static void
 _single_transform_name_to_obstack (struct transform *tf, char *input)
 {
-  int rc;
   idx_t nmatches = 0;
   enum case_ctl_type case_ctl = ctl_stop,  /* Current case conversion op */
                      save_ctl = ctl_stop;  /* Saved case_ctl for \u and \l */
-  regmatch_t *rmp = xinmalloc (tf->regex.re_nsub + 1, sizeof *rmp);
+  regmatch_t *rmp = tf->rmp;
 
   while (*input)
     {
       idx_t disp;
 
-      rc = regexec (&tf->regex, input, tf->regex.re_nsub + 1, rmp, 0);
-
-      if (rc == 0)
+      if (transform_exec (tf, input))
 	{
 	  struct replace_segm *segm;
 
@@ -559,7 +715,6 @@ _single_transform_name_to_obstack (struct transform *tf, char *input)
     }
 
   obstack_1grow (&stk, 0);
-  free (rmp);
 }
 
 static void
@@ -62,20 +62,28 @@ xattr_map_free (struct xattr_map *xattr_map)
   free (xattr_map->xm_map);
 }
 
+/* Add to MAP the attribute KEY, whose value VAL is LEN bytes long and
+   followed by a null byte.  MAP takes over KEY and VAL.  */
 void
-xattr_map_add (struct xattr_map *map,
-	       const char *key, const char *val, idx_t len)
+xattr_map_append (struct xattr_map *map, char *key, char *val, idx_t len)
 {
   if (map->xm_size == map->xm_max)
     map->xm_map = xpalloc (map->xm_map, &map->xm_max, 1, -1,
 			   sizeof *map->xm_map);
   struct xattr_array *p = &map->xm_map[map->xm_size];
-  p->xkey = xstrdup (key);
-  p->xval_ptr = ximemdup (val, len + 1);
+  p->xkey = key;
+  p->xval_ptr = val;
   p->xval_len = len;
   map->xm_size++;
 }
 
+void
+xattr_map_add (struct xattr_map *map,
+	       const char *key, const char *val, idx_t len)
+{
+  xattr_map_append (map, xstrdup (key), ximemdup (val, len + 1), len);
+}
+
 MAYBE_UNUSED static void
 xheader_xattr_add (struct tar_stat_info *st,
 		   const char *key, const char *val, idx_t len)
@@ -275,10 +283,11 @@ fixup_extra_acl_fields (char *ptr)
 }
 
 /* Set the "system.posix_acl_access/system.posix_acl_default" extended
-   attribute.  Called only when acls_option > 0. */
+   attribute.  If FD is nonnegative, it is a file descriptor for the file,
+   used to set the access ACL.  Called only when acls_option > 0. */
 static void
 xattrs__acls_set (struct tar_stat_info const *st,
-		  char const *file_name, acl_type_t type,
+		  char const *file_name, int fd, acl_type_t type,
 		  char *ptr, bool def)
 {
   acl_t acl;
@@ -310,12 +319,22 @@ xattrs__acls_set (struct tar_stat_info const *st,
       return;
     }
 
-  struct fdbase f = fdbase (file_name);
-  if (f.fd == BADFD || tar_acl_set_file_at (f.fd, f.base, type, acl) < 0)
-    /* warn even if filesystem does not support acls */
-    warnopt (WARN_XATTR_WRITE, errno,
-	     _ ("tar_acl_set_file_at: Cannot set POSIX ACLs for file '%s'"),
-	     quote (file_name));
+  if (0 <= fd && type == ACL_TYPE_ACCESS)
+    {
+      if (acl_set_fd (fd, acl) < 0)
+	warnopt (WARN_XATTR_WRITE, errno,
+		 _ ("acl_set_fd: Cannot set POSIX ACLs for file '%s'"),
+		 quote (file_name));
+    }
+  else
+    {
+      struct fdbase f = fdbase (file_name);
+      if (f.fd == BADFD || tar_acl_set_file_at (f.fd, f.base, type, acl) < 0)
+	/* warn even if filesystem does not support acls */
+	warnopt (WARN_XATTR_WRITE, errno,
+		 _ ("tar_acl_set_file_at: Cannot set POSIX ACLs for file '%s'"),
+		 quote (file_name));
+    }
 
   acl_free (acl);
 }
@@ -476,7 +495,8 @@ xattrs_acls_get (MAYBE_UNUSED int parentfd, MAYBE_UNUSED char const *file_name,
 
 void
 xattrs_acls_set (MAYBE_UNUSED struct tar_stat_info const *st,
-                 MAYBE_UNUSED char const *file_name, char typeflag)
+                 MAYBE_UNUSED char const *file_name, MAYBE_UNUSED int fd,
+		 char typeflag)
 {
   if (acls_option > 0 && typeflag != SYMTYPE)
     {
@@ -488,10 +508,10 @@ xattrs_acls_set (MAYBE_UNUSED struct tar_stat_info const *st,
 	  paxwarn (0, _("POSIX ACL support is not available"));
 	}
 #else
-      xattrs__acls_set (st, file_name, ACL_TYPE_ACCESS,
+      xattrs__acls_set (st, file_name, fd, ACL_TYPE_ACCESS,
 			st->acls_a_ptr, false);
       if (typeflag == DIRTYPE || typeflag == GNUTYPE_DUMPDIR)
-        xattrs__acls_set (st, file_name, ACL_TYPE_DEFAULT,
+        xattrs__acls_set (st, file_name, fd, ACL_TYPE_DEFAULT,
 			  st->acls_d_ptr, true);
 #endif
     }
@@ -593,25 +613,36 @@ xattrs_xattrs_get (MAYBE_UNUSED int parentfd,
 }
 
 #ifdef HAVE_XATTRS
+/* Set the extended attribute ATTR of FILE_NAME to PTR of length LEN.
+   If FD is nonnegative, it is a file descriptor for the file.  */
 static void
-xattrs__fd_set (char const *file_name, char typeflag,
+xattrs__fd_set (char const *file_name, int fd, char typeflag,
                 const char *attr, const char *ptr, idx_t len)
 {
   if (ptr)
     {
       const char *sysname = "setxattrat";
       int ret;
-      struct fdbase f = fdbase (file_name);
 
-      if (f.fd == BADFD)
-	ret = -1;
-      else if (typeflag != SYMTYPE)
-	ret = setxattrat (f.fd, f.base, attr, ptr, len, 0);
+      if (0 <= fd && typeflag != SYMTYPE)
+	{
+	  sysname = "fsetxattr";
+	  ret = fsetxattr (fd, attr, ptr, len, 0);
+	}
       else
-        {
-          sysname = "lsetxattr";
-	  ret = lsetxattrat (f.fd, f.base, attr, ptr, len, 0);
-        }
+	{
+	  struct fdbase f = fdbase (file_name);
+
+	  if (f.fd == BADFD)
+	    ret = -1;
+	  else if (typeflag != SYMTYPE)
+	    ret = setxattrat (f.fd, f.base, attr, ptr, len, 0);
+	  else
+	    {
+	      sysname = "lsetxattr";
+	      ret = lsetxattrat (f.fd, f.base, attr, ptr, len, 0);
+	    }
+	}
 
       if (ret < 0)
 	warnopt (WARN_XATTR_WRITE, errno,
@@ -649,7 +680,8 @@ xattrs_selinux_get (MAYBE_UNUSED int parentfd, MAYBE_UNUSED char const *file_nam
 
 void
 xattrs_selinux_set (MAYBE_UNUSED struct tar_stat_info const *st,
-                    MAYBE_UNUSED char const *file_name, MAYBE_UNUSED char typeflag)
+                    MAYBE_UNUSED char const *file_name, MAYBE_UNUSED int fd,
+		    MAYBE_UNUSED char typeflag)
 {
   if (selinux_context_option > 0)
     {
@@ -667,19 +699,27 @@ xattrs_selinux_set (MAYBE_UNUSED struct tar_stat_info const *st,
       if (!st->cntx_name)
         return;
 
-      struct fdbase f = fdbase (file_name);
-      if (f.fd == BADFD)
-	ret = -1;
-      else if (typeflag != SYMTYPE)
-        {
-	  ret = setfileconat (f.fd, f.base, st->cntx_name);
-          sysname = "setfileconat";
-        }
+      if (0 <= fd && typeflag != SYMTYPE)
+	{
+	  ret = fsetfilecon (fd, st->cntx_name);
+	  sysname = "fsetfilecon";
+	}
       else
-        {
-	  ret = lsetfileconat (f.fd, f.base, st->cntx_name);
-          sysname = "lsetfileconat";
-        }
+	{
+	  struct fdbase f = fdbase (file_name);
+	  if (f.fd == BADFD)
+	    ret = -1;
+	  else if (typeflag != SYMTYPE)
+	    {
+	      ret = setfileconat (f.fd, f.base, st->cntx_name);
+	      sysname = "setfileconat";
+	    }
+	  else
+	    {
+	      ret = lsetfileconat (f.fd, f.base, st->cntx_name);
+	      sysname = "lsetfileconat";
+	    }
+	}
 
       if (ret < 0)
 	warnopt (WARN_XATTR_WRITE, errno,
@@ -732,7 +772,7 @@ xattrs_masked_out (const char *kw, bool archiving)
 
 void
 xattrs_xattrs_set (MAYBE_UNUSED struct tar_stat_info const *st,
-		   MAYBE_UNUSED char const *file_name,
+		   MAYBE_UNUSED char const *file_name, MAYBE_UNUSED int fd,
 		   MAYBE_UNUSED char typeflag, MAYBE_UNUSED bool later_run)
 {
   if (xattrs_option)
@@ -766,7 +806,7 @@ xattrs_xattrs_set (MAYBE_UNUSED struct tar_stat_info const *st,
             /* we don't want to restore this keyword */
             continue;
 
-	  xattrs__fd_set (file_name, typeflag, keyword,
+	  xattrs__fd_set (file_name, fd, typeflag, keyword,
                           st->xattr_map.xm_map[i].xval_ptr,
                           st->xattr_map.xm_map[i].xval_len);
         }
@@ -774,6 +814,25 @@ xattrs_xattrs_set (MAYBE_UNUSED struct tar_stat_info const *st,
     }
 }
 
+/* Return true if ST has extended attributes to restore that set the
+   layout of a regular file, which a file system may accept only on a
+   file that has never been opened: e.g. the striping of a file on
+   Lustre.  */
+bool
+xattrs_layout_p (MAYBE_UNUSED struct tar_stat_info const *st)
+{
+#ifdef HAVE_XATTRS
+  for (idx_t i = 0; i < st->xattr_map.xm_size; i++)
+    {
+      char const *keyword = st->xattr_map.xm_map[i].xkey + XATTRS_PREFIX_LEN;
+      if ((streq (keyword, "lustre.lov") || streq (keyword, "trusted.lov"))
+	  && !xattrs_masked_out (keyword, false))
+	return true;
+    }
+#endif
+  return false;
+}
+
 void
 xattrs_print_char (struct tar_stat_info const *st, char *output)
 {
@@ -33,13 +33,16 @@ extern void xattrs_selinux_get (int parentfd, char const *file_name,
 extern void xattrs_xattrs_get (int parentfd, char const *file_name,
                                struct tar_stat_info *st, int fd);
 
+/* The setters below use the file descriptor FD if it is nonnegative,
+   and FILE_NAME otherwise.  */
 extern void xattrs_acls_set (struct tar_stat_info const *st,
-                             char const *file_name, char typeflag);
+                             char const *file_name, int fd, char typeflag);
 extern void xattrs_selinux_set (struct tar_stat_info const *st,
-                                char const *file_name, char typeflag);
+                                char const *file_name, int fd, char typeflag);
 extern void xattrs_xattrs_set (struct tar_stat_info const *st,
-                               char const *file_name, char typeflag,
+                               char const *file_name, int fd, char typeflag,
                                bool later_run);
+extern bool xattrs_layout_p (struct tar_stat_info const *st);
 
 extern void xattrs_print_char (struct tar_stat_info const *st, char *output);
 extern void xattrs_print (struct tar_stat_info const *st);
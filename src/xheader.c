@@ -548,22 +548,71 @@ struct xhdr_tab
    even more of a pain.  */
 extern struct xhdr_tab const xhdr_tab[];
 
-static struct xhdr_tab const *
-locate_handler (char const *keyword)
+/* Each record of each extended header is looked up, so index xhdr_tab.
+   Whole keywords are looked up in a hash table; the few namespace
+   prefixes (e.g. SCHILY.xattr, whose keywords end in an attribute name)
+   are kept apart and tried only if that fails.  */
+static Hash_table *xhdr_keyword_table;
+static struct xhdr_tab const **xhdr_prefix_tab;
+
+static size_t
+xhdr_tab_hash (void const *entry, size_t n_buckets)
+{
+  struct xhdr_tab const *p = entry;
+  return hash_string (p->keyword, n_buckets);
+}
+
+static bool
+xhdr_tab_compare (void const *entry1, void const *entry2)
+{
+  struct xhdr_tab const *p1 = entry1;
+  struct xhdr_tab const *p2 = entry2;
+  return streq (p1->keyword, p2->keyword);
+}
+
+static void
+xhdr_tab_index (void)
 {
   struct xhdr_tab const *p;
+  idx_t nprefixes = 0;
+
+  xhdr_keyword_table = hash_initialize (0, NULL, xhdr_tab_hash,
+					xhdr_tab_compare, NULL);
+  if (!xhdr_keyword_table)
+    xalloc_die ();
+  for (p = xhdr_tab; p->keyword; p++)
+    if (p->prefix)
+      nprefixes++;
+    else if (!hash_insert (xhdr_keyword_table, p))
+      xalloc_die ();
+
+  xhdr_prefix_tab = xinmalloc (nprefixes + 1, sizeof *xhdr_prefix_tab);
+  nprefixes = 0;
   for (p = xhdr_tab; p->keyword; p++)
     if (p->prefix)
-      {
-	idx_t kwlen = strlen (p->keyword);
-	if (strncmp (p->keyword, keyword, kwlen) == 0 && keyword[kwlen] == '.')
-          return p;
-      }
-    else
-      {
-        if (streq (p->keyword, keyword))
-          return p;
-      }
+      xhdr_prefix_tab[nprefixes++] = p;
+  xhdr_prefix_tab[nprefixes] = NULL;
+}
+
+static struct xhdr_tab const *
+locate_handler (char const *keyword)
+{
+  if (!xhdr_keyword_table)
+    xhdr_tab_index ();
+
+  struct xhdr_tab key;
+  key.keyword = keyword;
+  struct xhdr_tab const *p = hash_lookup (xhdr_keyword_table, &key);
+  if (p)
+    return p;
+
+  for (struct xhdr_tab const **pp = xhdr_prefix_tab; *pp; pp++)
+    {
+      idx_t kwlen = strlen ((*pp)->keyword);
+      if (strncmp ((*pp)->keyword, keyword, kwlen) == 0
+	  && keyword[kwlen] == '.')
+	return *pp;
+    }
 
   return NULL;
 }
@@ -784,8 +833,23 @@ xheader_read (struct xheader *xhdr, union block *p, off_t size)
   size = size_plus_1 - 1;
 
   xhdr->size = size;
+
+  /* Decoding needs a null byte after the data.  If the padding of the
+     last block provides it, and the whole header is in the current
+     record, decode it where it lies; it stays valid until the next
+     call to read_header.  */
+  if (fits_in_record (p, size - BLOCKSIZE) && size % BLOCKSIZE != 0
+      && charptr (p)[size] == '\0')
+    {
+      xhdr->buffer = charptr (p);
+      xhdr->borrowed = true;
+      set_next_block_after (charptr (p) + size - 1);
+      return;
+    }
+
   xhdr->buffer = xmalloc (size_plus_1);
   xhdr->buffer[size] = '\0';
+  xhdr->borrowed = false;
 
   do
     {
@@ -804,6 +868,18 @@ xheader_read (struct xheader *xhdr, union block *p, off_t size)
   while (size > 0);
 }
 
+/* If XHDR is decoded from the archive record, copy it to memory of
+   its own, so that it survives refilling the record.  */
+void
+xheader_keep (struct xheader *xhdr)
+{
+  if (xhdr->borrowed)
+    {
+      xhdr->buffer = ximemdup0 (xhdr->buffer, xhdr->size);
+      xhdr->borrowed = false;
+    }
+}
+
 /* xattr_encode_keyword() substitutes '=' ~~> '%3D' and '%' ~~> '%25'
    in extended attribute keywords.  This is needed because the '=' character
    has special purpose in extended attribute header - it splits keyword and
@@ -901,10 +977,11 @@ xheader_destroy (struct xheader *xhdr)
       free (xhdr->stk);
       xhdr->stk = NULL;
     }
-  else
+  else if (!xhdr->borrowed)
     free (xhdr->buffer);
   xhdr->buffer = NULL;
   xhdr->size = 0;
+  xhdr->borrowed = false;
 }
 
 
@@ -1003,6 +1080,24 @@ decode_string (char **string, char const *arg)
     }
 }
 
+/* Like decode_string, for the member strings of ST that may live in
+   its arena.  */
+static void
+decode_member_string (struct tar_stat_info *st, char **string,
+		      char const *arg)
+{
+  char *converted;
+  if (!st->arena)
+    decode_string (string, arg);
+  else if (utf8_convert (false, arg, &converted))
+    {
+      *string = tar_stat_strndup (st, converted, strlen (converted));
+      free (converted);
+    }
+  else
+    *string = tar_stat_strndup (st, arg, strlen (arg));
+}
+
 static void
 code_time (struct timespec t, char const *keyword, struct xheader *xhdr)
 {
@@ -1155,7 +1250,7 @@ gname_decoder (struct tar_stat_info *st,
 	       char const *arg,
 	       idx_t UNNAMED (size))
 {
-  decode_string (&st->gname, arg);
+  decode_member_string (st, &st->gname, arg);
 }
 
 static void
@@ -1301,7 +1396,7 @@ uname_decoder (struct tar_stat_info *st,
 	       char const *arg,
 	       idx_t UNNAMED (size))
 {
-  decode_string (&st->uname, arg);
+  decode_member_string (st, &st->uname, arg);
 }
 
 static void
@@ -1569,7 +1664,7 @@ xattr_selinux_decoder (struct tar_stat_info *st,
 		       char const *UNNAMED (keyword), char const *arg,
 		       idx_t UNNAMED (size))
 {
-  decode_string (&st->cntx_name, arg);
+  decode_member_string (st, &st->cntx_name, arg);
 }
 
 static void
@@ -1584,7 +1679,7 @@ xattr_acls_a_decoder (struct tar_stat_info *st,
 		      char const *UNNAMED (keyword),
 		      char const *arg, idx_t size)
 {
-  st->acls_a_ptr = xmemdup (arg, size + 1);
+  st->acls_a_ptr = tar_stat_strndup (st, arg, size);
   st->acls_a_len = size;
 }
 
@@ -1600,7 +1695,7 @@ xattr_acls_d_decoder (struct tar_stat_info *st,
 		      char const *UNNAMED (keyword), char const *arg,
 		      idx_t size)
 {
-  st->acls_d_ptr = xmemdup (arg, size + 1);
+  st->acls_d_ptr = tar_stat_strndup (st, arg, size);
   st->acls_d_len = size;
 }
 
@@ -1619,16 +1714,10 @@ static void
 xattr_decoder (struct tar_stat_info *st,
                char const *keyword, char const *arg, idx_t size)
 {
-  char *xkey;
-
-  /* copy keyword */
-  xkey = xstrdup (keyword);
-
+  char *xkey = tar_stat_strndup (st, keyword, strlen (keyword));
   xattr_decode_keyword (xkey);
-
-  xattr_map_add (&st->xattr_map, xkey, arg, size);
-
-  free (xkey);
+  xattr_map_append (&st->xattr_map, xkey, tar_stat_strndup (st, arg, size),
+		    size);
 }
 
 static void
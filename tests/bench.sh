@@ -0,0 +1,205 @@
+#! /bin/sh
+# Performance benchmarks for GNU tar.
+# Copyright 2026 Free Software Foundation, Inc.
+
+# This file is part of GNU tar.
+
+# GNU tar is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+
+# GNU tar is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+# Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: bench.sh
+#
+# Generates a synthetic tree with mktree and runs each tar subcommand
+# (create, list, diff, extract, delete, level 0 and level 1 incremental
+# dumps) on every kind of data in it.  The "renames" operation makes a
+# level 1 dump after renaming every directory at the top of the data
+# set, so that the names of all the directories below them change.
+# The "pax" operation lists a POSIX
+# format copy of the archive, to measure extended header decoding.  The
+# "headers" operation lists an archive of synthetic headers made by
+# mkheaders, to measure header parsing alone.  Each run produces one line
+# of JSON (see benchrun.c).  Runs are controlled by the following
+# variables:
+#
+#   TAR           tar binary to measure (default: tar found in PATH)
+#   BENCH_DIR     scratch directory (default: ./bench.dir)
+#   BENCH_KINDS   comma-separated mktree kinds (default: all of them)
+#   BENCH_SCALE   mktree scale factor (default: 1)
+#   BENCH_SEED    mktree seed (default: 1)
+#   BENCH_OUTPUT  file to append results to (default: standard output)
+#   BENCH_STRACE  if "no", do not count system calls even when strace
+#                 is available
+#   BENCH_ALLOCS  if "yes", count heap allocations with valgrind (slow)
+#   BENCH_OPS     space-separated subset of the operations to run
+#
+# The tree is kept in BENCH_DIR between runs and regenerated only if
+# the kinds, scale or seed change, so that timings of successive tar
+# builds can be compared on identical input.
+
+: ${TAR:=tar}
+: ${BENCH_DIR:=bench.dir}
+: ${BENCH_KINDS:=small,huge,sparse,deep,xattr,hardlink}
+: ${BENCH_SCALE:=1}
+: ${BENCH_SEED:=1}
+: ${BENCH_OPS:=create list diff extract delete incremental renames pax headers}
+
+set -e
+
+if test -z "$BENCH_STRACE"; then
+  if strace -o /dev/null true >/dev/null 2>&1; then
+    BENCH_STRACE=yes
+  else
+    BENCH_STRACE=no
+  fi
+fi
+
+if test "$BENCH_ALLOCS" = yes \
+   && ! valgrind -q --tool=memcheck true >/dev/null 2>&1; then
+  echo "bench.sh: valgrind not available; not counting allocations" >&2
+  BENCH_ALLOCS=no
+fi
+
+benchrun_opts=
+test -n "$BENCH_OUTPUT" && benchrun_opts="-o $BENCH_OUTPUT"
+
+mkdir -p "$BENCH_DIR"
+cd "$BENCH_DIR"
+
+stamp="$BENCH_KINDS $BENCH_SCALE $BENCH_SEED"
+if test ! -d tree || test "`cat tree.stamp 2>/dev/null`" != "$stamp"; then
+  rm -rf tree tree.stamp
+  mktree -s "$BENCH_SEED" -n "$BENCH_SCALE" -k "$BENCH_KINDS" tree
+  echo "$stamp" > tree.stamp
+fi
+
+# Count system calls made by the given command, including its children.
+count_syscalls() {
+  if test "$BENCH_STRACE" = yes; then
+    strace -f -c -o syscalls.out "$@" >/dev/null 2>&1 || :
+    awk '$NF == "total" { print $4 }' syscalls.out
+    rm -f syscalls.out
+  fi
+}
+
+# Count heap allocations made by the given command.
+count_allocs() {
+  if test "$BENCH_ALLOCS" = yes; then
+    valgrind --tool=memcheck --log-file=allocs.out "$@" >/dev/null 2>&1 || :
+    sed -n 's/.*total heap usage: \([0-9,]*\) allocs.*/\1/p' allocs.out |
+      tr -d ,
+    rm -f allocs.out
+  fi
+}
+
+# measure NAME SETUP COMMAND...
+# Evaluate SETUP, then run COMMAND under strace to count its system
+# calls (and under valgrind to count its allocations, if requested),
+# evaluating SETUP again before each run, and time COMMAND.  The size
+# of the archive named by $archive (default archive.tar) after SETUP is
+# reported as the amount of data processed.
+measure() {
+  name=$1
+  setup=$2
+  shift 2
+  eval "$setup"
+  calls=`count_syscalls "$@"`
+  eval "$setup"
+  allocs=`count_allocs "$@"`
+  eval "$setup"
+  bytes=`wc -c < ${archive-archive.tar} | tr -d ' '`
+  benchrun $benchrun_opts -n "$name" -b "$bytes" ${calls:+-c $calls} \
+    ${allocs:+-a $allocs} "$@" \
+    || echo "bench.sh: $name failed" >&2
+}
+
+for kind in `echo $BENCH_KINDS | tr , ' '`; do
+  case $kind in
+  sparse) opts=--sparse ;;
+  xattr)  opts=--xattrs ;;
+  *)      opts= ;;
+  esac
+
+  rm -rf out archive.tar copy.tar pax.tar snapshot snapshot.1
+  $TAR $opts -cf archive.tar -C tree $kind
+  $TAR $opts -g snapshot -cf /dev/null -C tree $kind
+
+  for op in $BENCH_OPS; do
+    case $op in
+    create)
+      measure $kind.create "rm -f copy.tar" \
+	$TAR $opts -cf copy.tar -C tree $kind
+      ;;
+    list)
+      measure $kind.list : $TAR $opts -tf archive.tar
+      ;;
+    diff)
+      measure $kind.diff : $TAR $opts -df archive.tar -C tree
+      ;;
+    extract)
+      measure $kind.extract "rm -rf out; mkdir out" \
+	$TAR $opts -xf archive.tar -C out
+      ;;
+    delete)
+      # tar cannot delete members from archives with old GNU sparse
+      # headers.
+      test $kind = sparse && continue
+      member=`$TAR -tf archive.tar | sed -n 2p`
+      measure $kind.delete "cp archive.tar copy.tar" \
+	$TAR --delete -f copy.tar "$member"
+      ;;
+    incremental)
+      measure $kind.incremental "cp snapshot snapshot.1; rm -f copy.tar" \
+	$TAR $opts -g snapshot.1 -cf copy.tar -C tree $kind
+      ;;
+    renames)
+      for d in tree/$kind/*; do
+	test -d "$d" && mv "$d" "$d.renamed"
+      done
+      measure $kind.renames "cp snapshot snapshot.1; rm -f copy.tar" \
+	$TAR $opts -g snapshot.1 -cf copy.tar -C tree $kind
+      for d in tree/$kind/*.renamed; do
+	test -d "$d" && mv "$d" "${d%.renamed}"
+      done
+      ;;
+    headers)
+      # Does not depend on the kind of data; run it once, below.
+      ;;
+    pax)
+      # In POSIX format every member gets an extended header with at
+      # least its atime and ctime, plus one record per extended
+      # attribute in the xattr data set.
+      test -f pax.tar || $TAR $opts --format=posix -cf pax.tar -C tree $kind
+      archive=pax.tar
+      measure $kind.pax : $TAR $opts -tvf pax.tar
+      archive=archive.tar
+      ;;
+    *)
+      echo "bench.sh: unknown operation: $op" >&2
+      exit 1
+      ;;
+    esac
+  done
+done
+
+case " $BENCH_OPS " in
+*" headers "*)
+  count=`expr 200000 \* $BENCH_SCALE`
+  mkheaders -s "$BENCH_SEED" -n $count headers.tar
+  archive=headers.tar
+  measure headers.list : $TAR -tvf headers.tar
+  archive=archive.tar
+  rm -f headers.tar
+  ;;
+esac
+
+rm -rf out archive.tar copy.tar pax.tar snapshot snapshot.1
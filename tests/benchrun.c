@@ -0,0 +1,189 @@
+/* Run a command and report its resource usage for tar benchmarks.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 3, or (at your option) any later
+   version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+   Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Usage: benchrun -n NAME [-b BYTES] [-c SYSCALLS] [-a ALLOCS] [-o FILE]
+		   COMMAND [ARG...]
+
+   Runs COMMAND with its standard output redirected to /dev/null, waits
+   for it and prints one line of JSON describing the run: its NAME, exit
+   status, wall clock time, user and system CPU time (in seconds) and
+   maximum resident set size (in KiB).  If BYTES
+   is given, the throughput in MiB per wall clock second is added; if
+   SYSCALLS or ALLOCS is given (the number of system calls or heap
+   allocations counted by a separate traced run), it is copied to the
+   record.  The record is appended to FILE, or written to the
+   standard output.  The exit status is that of COMMAND.  */
+
+#include <config.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static char const *progname;
+
+static _Noreturn void
+usage (int status)
+{
+  fprintf (status ? stderr : stdout,
+	   "usage: %s -n NAME [-b BYTES] [-c SYSCALLS] [-a ALLOCS] [-o FILE]"
+	   " COMMAND [ARG...]\n", progname);
+  exit (status);
+}
+
+static double
+tv_seconds (struct timeval tv)
+{
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Print S as a JSON string.  Benchmark names are plain ASCII, so only
+   the quote and backslash need escaping.  */
+static void
+print_string (FILE *fp, char const *s)
+{
+  fputc ('"', fp);
+  for (; *s; s++)
+    {
+      if (*s == '"' || *s == '\\')
+	fputc ('\\', fp);
+      fputc (*s, fp);
+    }
+  fputc ('"', fp);
+}
+
+int
+main (int argc, char **argv)
+{
+  char const *name = NULL;
+  char const *output = NULL;
+  char const *syscalls = NULL;
+  char const *allocs = NULL;
+  double bytes = -1;
+  int c;
+
+  progname = argv[0];
+  while ((c = getopt (argc, argv, "+a:b:c:hn:o:")) != -1)
+    switch (c)
+      {
+      case 'a':
+	allocs = optarg;
+	break;
+
+      case 'b':
+	bytes = strtod (optarg, NULL);
+	break;
+
+      case 'c':
+	syscalls = optarg;
+	break;
+
+      case 'n':
+	name = optarg;
+	break;
+
+      case 'o':
+	output = optarg;
+	break;
+
+      case 'h':
+	usage (0);
+
+      default:
+	usage (1);
+      }
+
+  if (!name || optind == argc)
+    usage (1);
+
+  struct timespec start, stop;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      fprintf (stderr, "%s: cannot fork: %s\n", progname, strerror (errno));
+      return 1;
+    }
+  if (pid == 0)
+    {
+      int fd = open ("/dev/null", O_WRONLY);
+      if (fd < 0 || dup2 (fd, STDOUT_FILENO) < 0)
+	{
+	  fprintf (stderr, "%s: cannot redirect output: %s\n", progname,
+		   strerror (errno));
+	  _exit (127);
+	}
+      close (fd);
+      execvp (argv[optind], argv + optind);
+      fprintf (stderr, "%s: cannot run %s: %s\n", progname, argv[optind],
+	       strerror (errno));
+      _exit (127);
+    }
+
+  int status;
+  struct rusage ru;
+  while (wait4 (pid, &status, 0, &ru) < 0)
+    if (errno != EINTR)
+      {
+	fprintf (stderr, "%s: wait failed: %s\n", progname, strerror (errno));
+	return 1;
+      }
+  clock_gettime (CLOCK_MONOTONIC, &stop);
+
+  double wall = (stop.tv_sec - start.tv_sec)
+		+ (stop.tv_nsec - start.tv_nsec) / 1e9;
+  int exit_status = WIFEXITED (status) ? WEXITSTATUS (status)
+		    : 128 + WTERMSIG (status);
+
+  FILE *fp = output ? fopen (output, "a") : stdout;
+  if (!fp)
+    {
+      fprintf (stderr, "%s: cannot open %s: %s\n", progname, output,
+	       strerror (errno));
+      return 1;
+    }
+
+  fputs ("{\"name\":", fp);
+  print_string (fp, name);
+  fprintf (fp, ",\"status\":%d,\"wall\":%.6f,\"user\":%.6f,\"sys\":%.6f"
+	   ",\"maxrss_kb\":%ld",
+	   exit_status, wall, tv_seconds (ru.ru_utime),
+	   tv_seconds (ru.ru_stime), ru.ru_maxrss);
+  if (0 <= bytes)
+    fprintf (fp, ",\"bytes\":%.0f,\"mib_per_s\":%.3f", bytes,
+	     wall > 0 ? bytes / (1024 * 1024) / wall : 0);
+  if (syscalls)
+    fprintf (fp, ",\"syscalls\":%s", syscalls);
+  if (allocs)
+    fprintf (fp, ",\"allocs\":%s", allocs);
+  fputs ("}\n", fp);
+
+  if (fp != stdout && fclose (fp) != 0)
+    {
+      fprintf (stderr, "%s: cannot write %s: %s\n", progname, output,
+	       strerror (errno));
+      return 1;
+    }
+  return exit_status;
+}
@@ -0,0 +1,145 @@
+/* Write a tar archive made of synthetic member headers, for benchmarks.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 3, or (at your option) any later
+   version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+   Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Usage: mkheaders [-s SEED] [-n COUNT] FILE
+
+   Writes to FILE a ustar archive of COUNT (default 100000) empty
+   regular file members with pseudo-random modes, owners and time
+   stamps, followed by the end-of-archive blocks.  Listing it with
+   "tar -tvf FILE" does little besides reading and decoding headers,
+   so it measures the header parsing code, and the numeric field
+   conversions in particular.  Given the same SEED and COUNT, the
+   archive is identical from run to run.  */
+
+#include <config.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum { BLOCKSIZE = 512 };
+
+static char const *progname;
+static uint64_t rng_state;
+
+/* xorshift64* generator, as in mktree.  */
+static uint64_t
+rng (void)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * UINT64_C (2685821657736338717);
+}
+
+/* Store VALUE in the SIZE-byte field WHERE as zero-padded octal
+   digits followed by a null, as tar does.  */
+static void
+octal (char *where, int size, uint64_t value)
+{
+  where[--size] = '\0';
+  while (size)
+    {
+      where[--size] = '0' + (value & 7);
+      value >>= 3;
+    }
+}
+
+static _Noreturn void
+usage (int status)
+{
+  fprintf (status ? stderr : stdout,
+	   "usage: %s [-s SEED] [-n COUNT] FILE\n", progname);
+  exit (status);
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned long count = 100000;
+  unsigned long seed = 1;
+  int c;
+
+  progname = argv[0];
+  while ((c = getopt (argc, argv, "hn:s:")) != -1)
+    switch (c)
+      {
+      case 'n':
+	count = strtoul (optarg, NULL, 10);
+	break;
+
+      case 's':
+	seed = strtoul (optarg, NULL, 10);
+	break;
+
+      case 'h':
+	usage (0);
+
+      default:
+	usage (1);
+      }
+
+  if (optind + 1 != argc)
+    usage (1);
+
+  FILE *fp = fopen (argv[optind], "wb");
+  if (!fp)
+    {
+      fprintf (stderr, "%s: cannot create %s: %s\n", progname, argv[optind],
+	       strerror (errno));
+      return 1;
+    }
+
+  rng_state = seed * UINT64_C (0x9E3779B97F4A7C15) + 1;
+  for (unsigned long i = 0; i < count; i++)
+    {
+      /* Field offsets from the POSIX ustar header layout.  */
+      char block[BLOCKSIZE];
+      memset (block, 0, sizeof block);
+      snprintf (block, 100, "d%04lu/f%08lu", i / 1000, i);
+      octal (block + 100, 8, rng () & 1 ? 0644 : 0755);
+      octal (block + 108, 8, rng () % 65536);
+      octal (block + 116, 8, rng () % 65536);
+      octal (block + 124, 12, 0);
+      octal (block + 136, 12, 1000000000 + rng () % 1000000000);
+      block[156] = '0';
+      memcpy (block + 257, "ustar", 6);
+      memcpy (block + 263, "00", 2);
+      snprintf (block + 265, 32, "u%u", (unsigned) (rng () % 100));
+      snprintf (block + 297, 32, "g%u", (unsigned) (rng () % 100));
+
+      unsigned sum = 0;
+      memset (block + 148, ' ', 8);
+      for (int j = 0; j < BLOCKSIZE; j++)
+	sum += (unsigned char) block[j];
+      octal (block + 148, 7, sum);
+
+      fwrite (block, sizeof block, 1, fp);
+    }
+
+  static char const zeros[2 * BLOCKSIZE];
+  fwrite (zeros, sizeof zeros, 1, fp);
+
+  if (ferror (fp) || fclose (fp) != 0)
+    {
+      fprintf (stderr, "%s: cannot write %s: %s\n", progname, argv[optind],
+	       strerror (errno));
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,354 @@
+/* Deterministic synthetic file tree generator for tar benchmarks.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify it
+   under the terms of the GNU General Public License as published by the
+   Free Software Foundation; either version 3, or (at your option) any later
+   version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General
+   Public License for more details.
+
+   You should have received a copy of the GNU General Public License along
+   with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+   Usage: mktree [-s SEED] [-n SCALE] [-k KIND[,KIND...]] DIR
+
+   Populates DIR with one subdirectory per requested KIND:
+
+     small     many small files spread over directories of 100 entries
+     huge      a few large files filled with pseudo-random data
+     sparse    large sparse images with a handful of data extents
+     deep      deeply nested directory chains
+     xattr     files carrying many user.* extended attributes
+     hardlink  a farm of files with many hard links each
+     all       all of the above (the default)
+
+   SCALE (default 1) multiplies the number of files or their sizes.
+   Given the same SEED and SCALE, the generated tree is identical from
+   run to run, down to file contents and file time stamps, so that archive
+   sizes and member order stay comparable between benchmark runs.  */
+
+#include <config.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined HAVE_SYS_XATTR_H
+# include <sys/xattr.h>
+#elif defined HAVE_ATTR_XATTR_H
+# include <attr/xattr.h>
+#endif
+
+/* All generated files get this modification time, plus a small
+   per-file offset.  */
+enum { BASE_TIME = 1700000000 };
+
+static char const *progname;
+static uint64_t rng_state;
+static unsigned long scale = 1;
+static unsigned long file_serial;
+
+static void
+die (char const *what, char const *name)
+{
+  fprintf (stderr, "%s: %s: %s: %s\n", progname, what, name, strerror (errno));
+  exit (1);
+}
+
+/* xorshift64* generator: fast, and reproducible across platforms.  */
+static uint64_t
+rng (void)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * UINT64_C (2685821657736338717);
+}
+
+static void
+fill (char *buf, size_t size)
+{
+  for (size_t i = 0; i < size; i += sizeof (uint64_t))
+    {
+      uint64_t v = rng ();
+      memcpy (buf + i, &v, size - i < sizeof v ? size - i : sizeof v);
+    }
+}
+
+static void
+make_dir (char const *name)
+{
+  if (mkdir (name, 0755) != 0 && errno != EEXIST)
+    die ("cannot create directory", name);
+}
+
+static void
+set_time (char const *name)
+{
+  struct timespec ts[2];
+  ts[0].tv_sec = ts[1].tv_sec = BASE_TIME + file_serial++ % 86400;
+  ts[0].tv_nsec = ts[1].tv_nsec = 0;
+  if (utimensat (AT_FDCWD, name, ts, AT_SYMLINK_NOFOLLOW) != 0)
+    die ("cannot set time stamps", name);
+}
+
+/* Create NAME holding SIZE bytes of pseudo-random data.  If HOLE is
+   nonzero, write only DATA bytes out of every HOLE, leaving the rest
+   unallocated.  */
+static void
+make_file (char const *name, off_t size, off_t hole, size_t data)
+{
+  static char buf[64 * 1024];
+  int fd = open (name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    die ("cannot create", name);
+
+  for (off_t off = 0; off < size; )
+    {
+      size_t n = size - off < (off_t) sizeof buf ? (size_t) (size - off) : sizeof buf;
+      if (hole)
+	{
+	  n = size - off < (off_t) data ? (size_t) (size - off) : data;
+	  if (lseek (fd, off, SEEK_SET) < 0)
+	    die ("cannot seek", name);
+	}
+      fill (buf, n);
+      if (write (fd, buf, n) != (ssize_t) n)
+	die ("cannot write", name);
+      off += hole ? hole : (off_t) n;
+    }
+
+  if (ftruncate (fd, size) != 0)
+    die ("cannot truncate", name);
+  if (close (fd) != 0)
+    die ("cannot close", name);
+  set_time (name);
+}
+
+static void
+gen_small (void)
+{
+  char name[64];
+  unsigned long count = 20000 * scale;
+
+  make_dir ("small");
+  for (unsigned long i = 0; i < count; i++)
+    {
+      if (i % 100 == 0)
+	{
+	  sprintf (name, "small/d%05lu", i / 100);
+	  make_dir (name);
+	}
+      sprintf (name, "small/d%05lu/f%05lu", i / 100, i);
+      make_file (name, rng () % 4096, 0, 0);
+    }
+}
+
+static void
+gen_huge (void)
+{
+  char name[64];
+
+  make_dir ("huge");
+  for (int i = 0; i < 3; i++)
+    {
+      sprintf (name, "huge/h%d", i);
+      make_file (name, (off_t) 128 * 1024 * 1024 * scale, 0, 0);
+    }
+}
+
+static void
+gen_sparse (void)
+{
+  char name[64];
+
+  make_dir ("sparse");
+  for (int i = 0; i < 4; i++)
+    {
+      sprintf (name, "sparse/img%d", i);
+      make_file (name, (off_t) 1024 * 1024 * 1024 * scale,
+		 (off_t) 64 * 1024 * 1024, 64 * 1024);
+    }
+}
+
+static void
+gen_deep (void)
+{
+  char name[4096];
+  unsigned long chains = 20 * scale;
+
+  make_dir ("deep");
+  for (unsigned long c = 0; c < chains; c++)
+    {
+      int len = sprintf (name, "deep/c%03lu", c);
+      make_dir (name);
+      for (int depth = 0; depth < 100 && len < (int) sizeof name - 64;
+	   depth++)
+	{
+	  len += sprintf (name + len, "/level%03d", depth);
+	  make_dir (name);
+	  sprintf (name + len, "/file");
+	  make_file (name, rng () % 1024, 0, 0);
+	  name[len] = '\0';
+	}
+    }
+}
+
+static void
+gen_xattr (void)
+{
+  char name[64];
+  char key[64];
+  char val[256];
+  unsigned long count = 2000 * scale;
+  bool warned = false;
+
+  make_dir ("xattr");
+  for (unsigned long i = 0; i < count; i++)
+    {
+      sprintf (name, "xattr/f%05lu", i);
+      make_file (name, rng () % 2048, 0, 0);
+      for (int k = 0; k < 8; k++)
+	{
+	  size_t len = 64 + rng () % (sizeof val - 64);
+	  sprintf (key, "user.bench.attr%d", k);
+	  for (size_t j = 0; j < len; j++)
+	    val[j] = 'a' + rng () % 26;
+#ifdef HAVE_XATTRS
+	  if (setxattr (name, key, val, len, 0) != 0)
+#endif
+	    {
+	      if (!warned)
+		fprintf (stderr, "%s: extended attributes not supported;"
+			 " generating plain files\n", progname);
+	      warned = true;
+	    }
+	}
+    }
+}
+
+static void
+gen_hardlink (void)
+{
+  char name[64];
+  char link_name[64];
+  unsigned long count = 2000 * scale;
+
+  make_dir ("hardlink");
+  for (int d = 0; d < 8; d++)
+    {
+      sprintf (name, "hardlink/d%d", d);
+      make_dir (name);
+    }
+  for (unsigned long i = 0; i < count; i++)
+    {
+      sprintf (name, "hardlink/d0/f%05lu", i);
+      make_file (name, rng () % 8192, 0, 0);
+      for (int d = 1; d < 8; d++)
+	{
+	  sprintf (link_name, "hardlink/d%d/f%05lu", d, i);
+	  if (link (name, link_name) != 0)
+	    die ("cannot link", link_name);
+	}
+    }
+}
+
+static struct kind
+{
+  char const *name;
+  void (*gen) (void);
+} const kinds[] = {
+  { "small", gen_small },
+  { "huge", gen_huge },
+  { "sparse", gen_sparse },
+  { "deep", gen_deep },
+  { "xattr", gen_xattr },
+  { "hardlink", gen_hardlink },
+  { NULL, NULL }
+};
+
+static _Noreturn void
+usage (int status)
+{
+  fprintf (status ? stderr : stdout,
+	   "usage: %s [-s SEED] [-n SCALE] [-k KIND[,KIND...]] DIR\n",
+	   progname);
+  exit (status);
+}
+
+int
+main (int argc, char **argv)
+{
+  char *list = NULL;
+  unsigned long seed = 1;
+  int c;
+
+  progname = argv[0];
+  while ((c = getopt (argc, argv, "hk:n:s:")) != -1)
+    switch (c)
+      {
+      case 'k':
+	list = optarg;
+	break;
+
+      case 'n':
+	scale = strtoul (optarg, NULL, 10);
+	if (scale == 0)
+	  usage (1);
+	break;
+
+      case 's':
+	seed = strtoul (optarg, NULL, 10);
+	break;
+
+      case 'h':
+	usage (0);
+
+      default:
+	usage (1);
+      }
+
+  if (optind + 1 != argc)
+    usage (1);
+
+  make_dir (argv[optind]);
+  if (chdir (argv[optind]) != 0)
+    die ("cannot change to directory", argv[optind]);
+  umask (022);
+
+  if (!list || strcmp (list, "all") == 0)
+    list = (char *) "small,huge,sparse,deep,xattr,hardlink";
+  list = strdup (list);
+  if (!list)
+    die ("cannot allocate", "kind list");
+
+  for (char *tok = strtok (list, ","); tok; tok = strtok (NULL, ","))
+    {
+      struct kind const *k;
+      for (k = kinds; k->name; k++)
+	if (strcmp (k->name, tok) == 0)
+	  break;
+      if (!k->name)
+	{
+	  fprintf (stderr, "%s: unknown kind: %s\n", progname, tok);
+	  usage (1);
+	}
+      /* Seed each kind independently, so that the contents of one kind
+	 do not depend on which other kinds were requested.  */
+      rng_state = seed * UINT64_C (0x9E3779B97F4A7C15) + (k - kinds) + 1;
+      file_serial = 0;
+      k->gen ();
+    }
+
+  free (list);
+  return 0;
+}